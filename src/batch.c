@@ -0,0 +1,625 @@
+#include "parser.h"
+#include "reporter.h"
+#include <dirent.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+extern Schedule* RmSimulation(SimPlan* plan);
+extern Schedule* EdfSimulation(SimPlan* plan);
+extern Schedule* FpSimulation(SimPlan* plan);
+extern Analysis* RmAnalysis(SimPlan* plan);
+extern Analysis* EdfAnalysis(SimPlan* plan);
+extern void CleanEdfSimulation(void);
+extern void SimulatePartitioned(SimPlan* plan, FILE* fout, ScheduleSummary* rm, ScheduleSummary* edf, SimStats* stats);
+
+// One plan of a batch and the results of simulating it
+typedef struct {
+	char* name; // name of the plan's output file within the output directory
+	char* file; // input file the plan is parsed from, NULL when it was read up front
+	SimPlan* plan;
+
+	bool done;
+	ScheduleSummary rm;
+	ScheduleSummary edf;
+} BatchItem;
+
+// Work shared by the worker threads, which claim items in order through `next`
+typedef struct {
+	BatchItem* items;
+	size_t count;
+	atomic_size_t next;
+
+	const char* outdir;
+	SimSettings settings;
+} Batch;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - runs the analysis of one scheduler, writes it under the given title and folds its verdict into a summary   |
+//---------------------------------------------------------------------------------------------------------------------+
+static void AnalyzePlan(SimPlan* plan, FILE* fout, const char* title, Analysis* (*analyze)(SimPlan*),
+	ScheduleSummary* summary) {
+	Analysis* analysis = analyze(plan);
+
+	fprintf(fout, "%s", title);
+	WriteAnalysis(fout, plan, analysis);
+
+	// Without a simulation, the analysis stands in for the simulated figures
+	if (plan->settings.analysis == ANALYSIS_ONLY) {
+		summary->utilization = (float)analysis->utilization;
+		summary->missedDeadlines = 0;
+		summary->preemptions = 0;
+		summary->aperiodicResponse = NAN;
+		for (taskid_t pTask = 0; pTask < analysis->pCount; ++pTask) {
+			summary->missedDeadlines += !analysis->meetsDeadline[pTask];
+		}
+	}
+
+	CleanAnalysis(analysis);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes a schedule's table and statistics, or only the statistics when the plan asks for a summary (or only counts)  |
+// The table is rendered on several threads, or replaced by a trace, when the plan's settings ask for it               |
+//---------------------------------------------------------------------------------------------------------------------+
+ScheduleSummary ReportSchedule(SimPlan* plan, FILE* fout, Schedule* sched, const char* title,
+	const char* scheduler) {
+	ScheduleSummary summary;
+	bool summaryOnly = plan->settings.summaryOnly || plan->settings.layout == LAYOUT_COUNTERS;
+	uint8_t format = summaryOnly ? FORMAT_TABLE : plan->settings.format;
+	if (format != FORMAT_TABLE) {
+		summary = WriteTrace(fout, plan, sched, scheduler, format);
+	}
+	else {
+		fprintf(fout, "%s", title);
+		if (summaryOnly) {
+			summary = SummarizeSchedule(sched);
+			WriteSummary(fout, &summary);
+			if (sched->stopped) {
+				fprintf(fout, "Stopped early at a missed deadline: %llu\r\n", (unsigned long long)sched->stoppedAt);
+			}
+		}
+		else if (plan->settings.renderThreads > 1) {
+			summary = WriteScheduleParallel(fout, sched, plan->settings.renderThreads);
+		}
+		else {
+			summary = WriteSchedule(fout, sched);
+		}
+	}
+
+	// The budget the server used goes below the statistics it is meant to improve
+	WriteServerUsage(fout, sched, scheduler, format);
+	return summary;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes a run's statistics below the summaries of its table or JSON lines in fout                                    |
+// Returns false, writing nothing, for a CSV or binary trace which keeps its shape (the caller puts them elsewhere)     |
+//---------------------------------------------------------------------------------------------------------------------+
+bool WriteStatsBelow(SimPlan* plan, FILE* fout, SimStats* stats) {
+	if (plan->settings.format == FORMAT_TABLE || plan->settings.summaryOnly) {
+		fprintf(fout, "\r\n------------------- Statistics --------------------\r\n");
+		WriteStats(fout, stats);
+		return true;
+	}
+	if (plan->settings.format == FORMAT_JSONL) {
+		WriteStats(fout, stats);
+		return true;
+	}
+	return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - runs one scheduler, timing it and collecting its counters into stats when they are wanted                 |
+//---------------------------------------------------------------------------------------------------------------------+
+static Schedule* TimeSimulation(SimPlan* plan, Schedule* (*simulate)(SimPlan*), PhaseTimer* timer,
+	SimCounters* counters) {
+	if (timer == NULL) {
+		return simulate(plan);
+	}
+
+	ResetCounters();
+	StartPhase(timer);
+	Schedule* sched = simulate(plan);
+	StopPhase(timer);
+	*counters = TakeCounters();
+	return sched;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Runs both schedulers over the given plan and writes their tables to the given file                                  |
+// Depending on the plan's settings the analytical tests follow the tables or replace them altogether                  |
+// The summary statistics of each are optionally returned through rm and edf, the phase timers through stats          |
+//---------------------------------------------------------------------------------------------------------------------+
+void SimulatePlan(SimPlan* plan, FILE* fout, ScheduleSummary* rm, ScheduleSummary* edf, SimStats* stats) {
+	ScheduleSummary rmSummary, edfSummary;
+
+	// Multiple processors have their own report, each core is simulated like a plan of its own
+	if (plan->settings.cores > 1) {
+		SimulatePartitioned(plan, fout, rm, edf, stats);
+		return;
+	}
+
+	if (plan->settings.analysis != ANALYSIS_ONLY) {
+		// Run the SimPlan
+		Schedule* rmsched = TimeSimulation(plan, RmSimulation, stats != NULL ? &stats->rmSimulation : NULL,
+			stats != NULL ? &stats->rm : NULL);
+		Schedule* edfsched = TimeSimulation(plan, EdfSimulation, stats != NULL ? &stats->edfSimulation : NULL,
+			stats != NULL ? &stats->edf : NULL);
+		// A polling, deferrable or sporadic server only runs in the forward engine, so it brings that along
+		bool fpServer = plan->server.kind == SERVER_POLLING || plan->server.kind == SERVER_DEFERRABLE ||
+			plan->server.kind == SERVER_SPORADIC;
+		Schedule* asapsched = NULL;
+		if (plan->settings.asap != ASAP_NONE || fpServer) {
+			asapsched = TimeSimulation(plan, FpSimulation, stats != NULL ? &stats->asapSimulation : NULL,
+				stats != NULL ? &stats->asap : NULL);
+		}
+
+		// Output the results
+		if (stats != NULL) {
+			StartPhase(&stats->report);
+		}
+		if (plan->settings.summaryOnly) {
+			WriteTraceHeader(fout, FORMAT_TABLE);
+		}
+		else {
+			WriteTraceHeader(fout, plan->settings.format);
+		}
+
+		// The ALAP table leaves such a server out, so the titles of both RM tables say which one ran it
+		char title[160], alapNote[96] = "", asapNote[64] = "";
+		if (fpServer) {
+			snprintf(alapNote, sizeof(alapNote), "(the %s server only runs in the ASAP schedule)\r\n",
+				ServerName(plan->server.kind));
+			snprintf(asapNote, sizeof(asapNote), "(with the %s server)\r\n", ServerName(plan->server.kind));
+		}
+		snprintf(title, sizeof(title), "--------------- ALAP Rate Monotonic ---------------\r\n%s", alapNote);
+		rmSummary = ReportSchedule(plan, fout, rmsched, title, "RM");
+		if (plan->settings.format == FORMAT_TABLE || plan->settings.summaryOnly) {
+			fprintf(fout, "\r\n");
+		}
+
+		// The forward fixed priority schedule goes next to the ALAP one it is compared with
+		if (asapsched != NULL) {
+			if (plan->settings.asap == ASAP_DEADLINE_MONOTONIC) {
+				snprintf(title, sizeof(title), "------------- ASAP Deadline Monotonic -------------\r\n%s", asapNote);
+				ReportSchedule(plan, fout, asapsched, title, "DM-ASAP");
+			}
+			else {
+				snprintf(title, sizeof(title), "--------------- ASAP Rate Monotonic ---------------\r\n%s", asapNote);
+				ReportSchedule(plan, fout, asapsched, title, "RM-ASAP");
+			}
+			if (plan->settings.format == FORMAT_TABLE || plan->settings.summaryOnly) {
+				fprintf(fout, "\r\n");
+			}
+		}
+
+		edfSummary = ReportSchedule(plan, fout, edfsched,
+			"------------- Earliest Deadline First -------------\r\n", "EDF");
+		if (stats != NULL) {
+			StopPhase(&stats->report);
+		}
+
+		// Cleanup
+		CleanSchedule(rmsched);
+		CleanSchedule(edfsched);
+		if (asapsched != NULL) {
+			CleanSchedule(asapsched);
+		}
+	}
+
+	if (plan->settings.analysis != ANALYSIS_NONE) {
+		if (stats != NULL) {
+			StartPhase(&stats->analysis);
+		}
+		if (plan->settings.analysis == ANALYSIS_APPEND) {
+			fprintf(fout, "\r\n");
+		}
+		AnalyzePlan(plan, fout, "----------- Rate Monotonic Response Time ----------\r\n", RmAnalysis, &rmSummary);
+		fprintf(fout, "\r\n");
+		AnalyzePlan(plan, fout, "---------- Earliest Deadline First Demand ---------\r\n", EdfAnalysis, &edfSummary);
+		if (stats != NULL) {
+			StopPhase(&stats->analysis);
+		}
+	}
+
+	if (rm != NULL) {
+		*rm = rmSummary;
+	}
+	if (edf != NULL) {
+		*edf = edfSummary;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - joins a directory and a file name into a newly allocated path                                              |
+//---------------------------------------------------------------------------------------------------------------------+
+static char* JoinPath(const char* dir, const char* name) {
+	size_t dirLen = strlen(dir), nameLen = strlen(name);
+	char* path = (char*)malloc(dirLen + nameLen + 2);
+	memcpy(path, dir, dirLen);
+	path[dirLen] = '/';
+	memcpy(path + dirLen + 1, name, nameLen + 1);
+	return path;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - qsort comparison ordering batch items by name                                                              |
+//---------------------------------------------------------------------------------------------------------------------+
+static int CompareItems(const void* a, const void* b) {
+	return strcmp(((BatchItem*)a)->name, ((BatchItem*)b)->name);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Worker thread: parses (if needed), simulates and reports plans until the batch runs out                             |
+// With --stats each plan's statistics go below its report, or beside it in <name>.stats.jsonl for a CSV or binary one |
+//---------------------------------------------------------------------------------------------------------------------+
+static void* BatchWorker(void* arg) {
+	Batch* batch = (Batch*)arg;
+
+	for (;;) {
+		size_t index = atomic_fetch_add(&batch->next, 1);
+		if (index >= batch->count) {
+			break;
+		}
+		BatchItem* item = batch->items + index;
+		SimStats stats;
+		memset(&stats, 0, sizeof(SimStats));
+
+		if (item->plan == NULL) {
+			StartPhase(&stats.parse);
+			item->plan = ParsePlan(item->file, batch->settings.quiet);
+			StopPhase(&stats.parse);
+			if (item->plan == NULL) {
+				continue;
+			}
+		}
+		item->plan->settings = batch->settings;
+
+		char* path = JoinPath(batch->outdir, item->name);
+		// Opened for reading too so the table can be memory-mapped
+		FILE* fout = fopen(path, "w+");
+		if (fout != NULL) {
+			SimulatePlan(item->plan, fout, &item->rm, &item->edf, batch->settings.stats ? &stats : NULL);
+			if (batch->settings.stats && !WriteStatsBelow(item->plan, fout, &stats)) {
+				char* statsPath = (char*)malloc(strlen(path) + 16);
+				sprintf(statsPath, "%s.stats.jsonl", path);
+				FILE* fstats = fopen(statsPath, "w");
+				if (fstats != NULL) {
+					WriteStats(fstats, &stats);
+					fclose(fstats);
+				}
+				else {
+					fprintf(stderr, "Unable to write \"%s\": %s\n", statsPath, strerror(errno));
+				}
+				free(statsPath);
+			}
+			fclose(fout);
+			item->done = true;
+		}
+		else {
+			fprintf(stderr, "Unable to write \"%s\": %s\n", path, strerror(errno));
+		}
+		free(path);
+
+		CleanPlan(item->plan);
+		item->plan = NULL;
+	}
+
+	// The job pool belongs to this thread, so it goes with it
+	CleanEdfSimulation();
+	return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Simulates every plan in the given input on a pool of threads (one per online processor)                             |
+// The input is either a directory holding one plan per file, or a single file of stacked plans                        |
+// Writes each plan's tables to its own file in outdir plus an aggregate summary.csv, returns a process exit code      |
+//---------------------------------------------------------------------------------------------------------------------+
+int RunBatch(const char* input, const char* outdir, SimSettings settings) {
+	Batch batch;
+	batch.items = NULL;
+	batch.count = 0;
+	atomic_init(&batch.next, 0);
+	batch.outdir = outdir;
+	batch.settings = settings;
+
+	size_t capacity = 0;
+	bool failed = false;
+
+	struct stat info;
+	if (stat(input, &info) != 0) {
+		fprintf(stderr, "Unable to read \"%s\": %s\n", input, strerror(errno));
+		return 1;
+	}
+
+	if (S_ISDIR(info.st_mode)) {
+		// One plan per regular file, parsed by the workers
+		DIR* dir = opendir(input);
+		struct dirent* entry;
+		while (dir != NULL && (entry = readdir(dir)) != NULL) {
+			char* file = JoinPath(input, entry->d_name);
+			if (stat(file, &info) != 0 || !S_ISREG(info.st_mode)) {
+				free(file);
+				continue;
+			}
+
+			if (batch.count == capacity) {
+				capacity = capacity == 0 ? 64 : capacity * 2;
+				batch.items = (BatchItem*)realloc(batch.items, sizeof(BatchItem) * capacity);
+			}
+
+			BatchItem* item = batch.items + (batch.count++);
+			memset(item, 0, sizeof(BatchItem));
+			item->file = file;
+			item->name = (char*)malloc(strlen(entry->d_name) + 5);
+			sprintf(item->name, "%s.out", entry->d_name);
+		}
+		if (dir != NULL) {
+			closedir(dir);
+		}
+
+		// Directory order is arbitrary, keep the summary stable between runs
+		if (batch.count > 1) {
+			qsort(batch.items, batch.count, sizeof(BatchItem), CompareItems);
+		}
+	}
+	else {
+		// Stacked plans have to be read in order, so they are read up front
+		PlanReader* reader = OpenPlans(input, settings.quiet);
+		const char* base = strrchr(input, '/') != NULL ? strrchr(input, '/') + 1 : input;
+
+		SimPlan* plan;
+		while (reader != NULL && (plan = NextPlan(reader)) != NULL) {
+			if (batch.count == capacity) {
+				capacity = capacity == 0 ? 64 : capacity * 2;
+				batch.items = (BatchItem*)realloc(batch.items, sizeof(BatchItem) * capacity);
+			}
+
+			BatchItem* item = batch.items + (batch.count++);
+			memset(item, 0, sizeof(BatchItem));
+			item->plan = plan;
+			item->name = (char*)malloc(strlen(base) + 32);
+			sprintf(item->name, "%s.%06lu.out", base, (unsigned long)batch.count);
+		}
+
+		// A malformed plan ends the input, the plans before it are still simulated
+		if (reader == NULL || reader->failed) {
+			failed = true;
+		}
+		if (reader != NULL) {
+			ClosePlans(reader);
+		}
+	}
+
+	if (mkdir(outdir, 0777) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Unable to create \"%s\": %s\n", outdir, strerror(errno));
+		return 1;
+	}
+
+	// Size the pool to the machine, but never larger than the batch
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t workers = cores > 0 ? (size_t)cores : 1;
+	if (workers > batch.count) {
+		workers = batch.count > 0 ? batch.count : 1;
+	}
+
+	pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * workers);
+	bool* started = (bool*)calloc(workers, sizeof(bool));
+	size_t running = 0;
+	for (size_t worker = 0; worker < workers; ++worker) {
+		started[worker] = pthread_create(threads + worker, NULL, BatchWorker, &batch) == 0;
+		running += started[worker];
+	}
+
+	// The workers share one queue, so the calling thread only steps in when no thread could be started
+	if (running == 0) {
+		BatchWorker(&batch);
+	}
+	for (size_t worker = 0; worker < workers; ++worker) {
+		if (started[worker]) {
+			pthread_join(threads[worker], NULL);
+		}
+	}
+	free(threads);
+	free(started);
+	workers = running > 0 ? running : 1;
+
+	// Aggregate summary: one row per plan in batch order (verdict-only runs count tasks which fail the analysis as missed)
+	size_t done = 0, rmFeasible = 0, edfFeasible = 0;
+	char* path = JoinPath(outdir, "summary.csv");
+	FILE* fsum = fopen(path, "w");
+	if (fsum != NULL) {
+		fprintf(fsum,
+			"plan,"
+			"rm_utilization,rm_missed,rm_preemptions,rm_aperiodic_response,"
+			"edf_utilization,edf_missed,edf_preemptions,edf_aperiodic_response\r\n");
+	}
+	for (size_t index = 0; index < batch.count; ++index) {
+		BatchItem* item = batch.items + index;
+		if (item->done) {
+			++done;
+			rmFeasible += item->rm.missedDeadlines == 0;
+			edfFeasible += item->edf.missedDeadlines == 0;
+
+			if (fsum != NULL) {
+				fprintf(fsum, "%s,%.4f,%llu,%llu,%.2f,%.4f,%llu,%llu,%.2f\r\n",
+					item->name,
+					item->rm.utilization,
+					(unsigned long long)item->rm.missedDeadlines,
+					(unsigned long long)item->rm.preemptions,
+					item->rm.aperiodicResponse,
+					item->edf.utilization,
+					(unsigned long long)item->edf.missedDeadlines,
+					(unsigned long long)item->edf.preemptions,
+					item->edf.aperiodicResponse);
+			}
+		}
+
+		free(item->name);
+		free(item->file);
+	}
+	if (fsum != NULL) {
+		fclose(fsum);
+	}
+	free(path);
+
+	printf("Plans simulated: %lu of %lu on %lu threads\nNo missed deadlines: RM %lu, EDF %lu\n",
+		(unsigned long)done, (unsigned long)batch.count, (unsigned long)workers,
+		(unsigned long)rmFeasible, (unsigned long)edfFeasible);
+
+	free(batch.items);
+	return done == batch.count && !failed ? 0 : 1;
+}
+
+// An acceptance-ratio sweep: `sets` random plans at each of `points` utilizations, claimed by workers in chunks
+typedef struct {
+	GenParams params;
+	double uMin;
+	double uStep;
+	size_t points;
+	uint64_t sets;
+	SimSettings settings;
+
+	atomic_uint_fast64_t next;
+	atomic_uint_fast64_t* rmAccepted; // per point
+	atomic_uint_fast64_t* edfAccepted; // per point
+} Sweep;
+
+// Sweep work is claimed this many plans at a time to keep the shared counter cold
+#define SWEEP_CHUNK 16
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - decides whether each scheduler meets every deadline of the plan, by simulation or by analysis alone        |
+//---------------------------------------------------------------------------------------------------------------------+
+static void JudgePlan(SimPlan* plan, bool* rmAccepted, bool* edfAccepted) {
+	if (plan->settings.analysis == ANALYSIS_ONLY) {
+		Analysis* rm = RmAnalysis(plan);
+		Analysis* edf = EdfAnalysis(plan);
+		*rmAccepted = rm->schedulable;
+		*edfAccepted = edf->schedulable;
+		CleanAnalysis(rm);
+		CleanAnalysis(edf);
+		return;
+	}
+
+	Schedule* rmsched = RmSimulation(plan);
+	*rmAccepted = SummarizeSchedule(rmsched).missedDeadlines == 0;
+	CleanSchedule(rmsched);
+
+	Schedule* edfsched = EdfSimulation(plan);
+	*edfAccepted = SummarizeSchedule(edfsched).missedDeadlines == 0;
+	CleanSchedule(edfsched);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Worker thread: generates and judges plans of the sweep until it runs out                                            |
+//---------------------------------------------------------------------------------------------------------------------+
+static void* SweepWorker(void* arg) {
+	Sweep* sweep = (Sweep*)arg;
+	uint64_t total = sweep->points * sweep->sets;
+
+	for (;;) {
+		uint64_t first = atomic_fetch_add(&sweep->next, SWEEP_CHUNK);
+		if (first >= total) {
+			break;
+		}
+
+		for (uint64_t index = first; index < first + SWEEP_CHUNK && index < total; ++index) {
+			size_t point = index / sweep->sets;
+			GenParams params = sweep->params;
+			params.utilization = sweep->uMin + point * sweep->uStep;
+
+			// Each plan's seed depends only on its place in the sweep
+			SimPlan* plan = GeneratePlan(&params, params.seed * 0x100000001B3ull + index);
+			plan->settings = sweep->settings;
+
+			bool rmAccepted, edfAccepted;
+			JudgePlan(plan, &rmAccepted, &edfAccepted);
+			if (rmAccepted) {
+				atomic_fetch_add(sweep->rmAccepted + point, 1);
+			}
+			if (edfAccepted) {
+				atomic_fetch_add(sweep->edfAccepted + point, 1);
+			}
+
+			CleanPlan(plan);
+		}
+	}
+
+	CleanEdfSimulation();
+	return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Measures the acceptance ratio of RM and EDF over generated plans at each utilization from uMin to uMax by uStep     |
+// A plan is accepted when its schedule misses no deadline (or it passes the analysis, for verdict-only settings)      |
+// Nothing but the result touches the filesystem: one CSV row per utilization, returns a process exit code             |
+//---------------------------------------------------------------------------------------------------------------------+
+int RunSweep(const char* fileout, GenParams params, double uMin, double uMax, double uStep, uint64_t sets,
+	SimSettings settings) {
+	FILE* fout = fopen(fileout, "w");
+	if (fout == NULL) {
+		fprintf(stderr, "Unable to write \"%s\": %s\n", fileout, strerror(errno));
+		return 1;
+	}
+
+	Sweep sweep;
+	sweep.params = params;
+	sweep.uMin = uMin;
+	sweep.uStep = uStep > 0.0 ? uStep : 1.0;
+	sweep.points = uMax >= uMin ? (size_t)((uMax - uMin) / sweep.uStep + 1e-9) + 1 : 1;
+	sweep.sets = sets > 0 ? sets : 1;
+	sweep.settings = settings;
+	atomic_init(&sweep.next, 0);
+	sweep.rmAccepted = (atomic_uint_fast64_t*)calloc(sweep.points, sizeof(atomic_uint_fast64_t));
+	sweep.edfAccepted = (atomic_uint_fast64_t*)calloc(sweep.points, sizeof(atomic_uint_fast64_t));
+
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t workers = cores > 0 ? (size_t)cores : 1;
+
+	pthread_t* threads = (pthread_t*)malloc(sizeof(pthread_t) * workers);
+	bool* started = (bool*)calloc(workers, sizeof(bool));
+	size_t running = 0;
+	for (size_t worker = 0; worker < workers; ++worker) {
+		started[worker] = pthread_create(threads + worker, NULL, SweepWorker, &sweep) == 0;
+		running += started[worker];
+	}
+
+	// The workers share one queue, so the calling thread only steps in when no thread could be started
+	if (running == 0) {
+		SweepWorker(&sweep);
+	}
+	for (size_t worker = 0; worker < workers; ++worker) {
+		if (started[worker]) {
+			pthread_join(threads[worker], NULL);
+		}
+	}
+	free(threads);
+	free(started);
+	workers = running > 0 ? running : 1;
+
+	fprintf(fout, "utilization,sets,rm_accepted,edf_accepted,rm_ratio,edf_ratio\r\n");
+	for (size_t point = 0; point < sweep.points; ++point) {
+		uint64_t rm = atomic_load(sweep.rmAccepted + point);
+		uint64_t edf = atomic_load(sweep.edfAccepted + point);
+		fprintf(fout, "%.4f,%llu,%llu,%llu,%.4f,%.4f\r\n",
+			uMin + point * sweep.uStep, (unsigned long long)sweep.sets,
+			(unsigned long long)rm, (unsigned long long)edf,
+			(double)rm / sweep.sets, (double)edf / sweep.sets);
+	}
+	fclose(fout);
+
+	printf("Plans judged: %llu at %lu utilizations on %lu threads\n",
+		(unsigned long long)(sweep.points * sweep.sets), (unsigned long)sweep.points, (unsigned long)workers);
+
+	free(sweep.rmAccepted);
+	free(sweep.edfAccepted);
+	return 0;
+}
@@ -0,0 +1,261 @@
+#include "parser.h"
+#include "reporter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern Schedule* RmSimulation(SimPlan* plan);
+extern Schedule* EdfSimulation(SimPlan* plan);
+extern Schedule* EdfResimulation(SimPlan* plan, Schedule* previous, SimPlan* oldPlan, PlanEdit* edit);
+extern void CleanEdfSimulation(void);
+
+// Pipeline stages measured for every configuration
+enum
+{
+	STAGE_PARSE         = 0, // ParsePlan of the plan written out in the input format
+	STAGE_MAKE          = 1, // MakeSchedule
+	STAGE_RM            = 2, // RmSimulation
+	STAGE_EDF           = 3, // EdfSimulation
+	STAGE_WRITE         = 4, // WriteSchedule of the RM schedule (SummarizeSchedule in the counters layout)
+	STAGE_RESUME        = 5, // EdfResimulation after adding an aperiodic task three quarters into the horizon
+	STAGE_COUNT         = 6,
+};
+
+static const char* stageNames[STAGE_COUNT] = { "parse", "make", "rm", "edf", "write", "resume" };
+static const char* layoutNames[] = { "dense", "compact", "counters" };
+
+// Repetitions of a stage stop once they have taken this long in total (or after BENCH_MAX_REPS)
+#define BENCH_MIN_SECONDS 0.05
+#define BENCH_MAX_REPS 50
+
+// What a measuring child reports back to the harness
+typedef struct {
+	double seconds; // fastest repetition
+	long reps;
+	long peakKib; // growth of the peak resident set over the first repetition
+} StageResult;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - seconds on the monotonic clock                                                                             |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline double Now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - peak resident set of this process so far, in KiB                                                           |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline long PeakKib(void) {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - runs one stage once on its prepared inputs, cleaning up whatever it produced                               |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RunStage(int stage, SimPlan* plan, const char* planFile, Schedule* sched, FILE* sink, SimPlan* edited,
+	PlanEdit* edit) {
+	switch (stage) {
+		case STAGE_PARSE:
+			CleanPlan(ParsePlan(planFile, true));
+			break;
+		case STAGE_MAKE:
+			CleanSchedule(MakeSchedule(plan));
+			break;
+		case STAGE_RM:
+			CleanSchedule(RmSimulation(plan));
+			break;
+		case STAGE_EDF:
+			CleanSchedule(EdfSimulation(plan));
+			break;
+		case STAGE_WRITE:
+			if (plan->settings.layout == LAYOUT_COUNTERS) {
+				SummarizeSchedule(sched);
+				break;
+			}
+			rewind(sink);
+			WriteSchedule(sink, sched);
+			break;
+		case STAGE_RESUME:
+			CleanSchedule(EdfResimulation(edited, sched, plan, edit));
+			break;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - measures one stage in a fresh child process, so the peak resident set isn't left over from other stages    |
+//---------------------------------------------------------------------------------------------------------------------+
+static StageResult MeasureStage(int stage, GenParams* params, SimSettings settings, const char* planFile) {
+	StageResult result = { 0.0, 0, 0 };
+
+	int channel[2];
+	if (pipe(channel) != 0) {
+		return result;
+	}
+
+	pid_t child = fork();
+	if (child == 0) {
+		close(channel[0]);
+
+		// Prepare the stage's inputs before taking the baseline
+		SimPlan* plan = GeneratePlan(params, params->seed);
+		plan->settings = settings;
+		Schedule* sched = NULL;
+		FILE* sink = NULL;
+		if (stage == STAGE_WRITE) {
+			sched = RmSimulation(plan);
+			sink = tmpfile();
+		}
+		SimPlan* edited = NULL;
+		PlanEdit edit = { EDIT_ADD_APERIODIC, 0, "edit", 1, (simtime_t)((plan->duration / 4) * 3) };
+		if (stage == STAGE_RESUME) {
+			plan->settings.resumable = 1;
+			sched = EdfSimulation(plan);
+			edited = EditPlan(plan, &edit);
+		}
+
+		long baseline = PeakKib();
+		double total = 0.0;
+		result.seconds = -1.0;
+		while (result.reps < BENCH_MAX_REPS && (result.reps == 0 || total < BENCH_MIN_SECONDS)) {
+			double start = Now();
+			RunStage(stage, plan, planFile, sched, sink, edited, &edit);
+			double seconds = Now() - start;
+
+			if (result.reps == 0) {
+				result.peakKib = PeakKib() - baseline;
+			}
+			if (result.seconds < 0.0 || seconds < result.seconds) {
+				result.seconds = seconds;
+			}
+			total += seconds;
+			++result.reps;
+		}
+
+		if (write(channel[1], &result, sizeof(result)) != sizeof(result)) {
+			_exit(1);
+		}
+		_exit(0);
+	}
+
+	close(channel[1]);
+	if (child > 0) {
+		if (read(channel[0], &result, sizeof(result)) != sizeof(result)) {
+			result.reps = 0;
+		}
+		waitpid(child, NULL, 0);
+	}
+	close(channel[0]);
+	return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Benchmark harness for the simulation pipeline (make bench)                                                          |
+// Sweeps task count, horizon and utilization over generated plans and writes one CSV row per stage per configuration  |
+// Usage: lab2_bench <results.csv> [--quick] [--compact|--counters] [--label <build name>]                             |
+//---------------------------------------------------------------------------------------------------------------------+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		printf("Usage: lab2_bench <results.csv> [--quick] [--compact|--counters] [--label <build name>]\n");
+		return 1;
+	}
+
+	const char* fileout = argv[1];
+	const char* label = "default";
+	int quick = 0;
+
+	SimSettings settings;
+	memset(&settings, 0, sizeof(SimSettings));
+	settings.quiet = 1;
+
+	for (int arg = 2; arg < argc; ++arg) {
+		if (strcmp(argv[arg], "--quick") == 0) {
+			quick = 1;
+		}
+		else if (strcmp(argv[arg], "--compact") == 0) {
+			settings.layout = LAYOUT_COMPACT;
+		}
+		else if (strcmp(argv[arg], "--counters") == 0) {
+			settings.layout = LAYOUT_COUNTERS;
+		}
+		else if (strcmp(argv[arg], "--label") == 0 && arg + 1 < argc) {
+			label = argv[++arg];
+		}
+	}
+
+	// The narrow build can't simulate past 65535 ticks or hold more than 255 tasks
+	static const unsigned long taskCounts[] = { 5, 20, 80, 200 };
+	static const unsigned long long horizons[] = { 1000, 10000, 60000 };
+	static const double utilizations[] = { 0.5, 0.9 };
+	size_t taskCount_n = quick ? 2 : sizeof(taskCounts) / sizeof(taskCounts[0]);
+	size_t horizon_n = quick ? 2 : sizeof(horizons) / sizeof(horizons[0]);
+	size_t utilization_n = sizeof(utilizations) / sizeof(utilizations[0]);
+
+	FILE* fout = fopen(fileout, "w");
+	if (fout == NULL) {
+		fprintf(stderr, "Unable to write \"%s\"\n", fileout);
+		return 1;
+	}
+	fprintf(fout, "build,layout,stage,tasks,horizon,utilization,jobs,reps,seconds,ns_per_tick,ns_per_job,peak_kib\n");
+
+	char planFile[] = "/tmp/lab2_bench_XXXXXX";
+	int planFd = mkstemp(planFile);
+	if (planFd < 0) {
+		fprintf(stderr, "Unable to create a temporary plan file\n");
+		return 1;
+	}
+	close(planFd);
+
+	for (size_t t = 0; t < taskCount_n; ++t) {
+		for (size_t h = 0; h < horizon_n; ++h) {
+			for (size_t u = 0; u < utilization_n; ++u) {
+				GenParams params;
+				DefaultGenParams(&params);
+				params.pCount = (taskid_t)taskCounts[t];
+				params.aCount = (taskid_t)(taskCounts[t] / 5);
+				params.duration = (simtime_t)horizons[h];
+				params.utilization = utilizations[u];
+				params.maxPeriod = (simtime_t)(horizons[h] / 4);
+
+				// The parse stage reads the same plan back from a file
+				SimPlan* plan = GeneratePlan(&params, params.seed);
+				uint64_t jobs = plan->aCount;
+				for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+					jobs += (plan->duration + plan->pTasks[pTask].T - 1) / plan->pTasks[pTask].T;
+				}
+				FILE* fplan = fopen(planFile, "w");
+				WritePlan(fplan, plan);
+				fclose(fplan);
+				CleanPlan(plan);
+
+				for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+					StageResult result = MeasureStage(stage, &params, settings, planFile);
+					if (result.reps == 0) {
+						fprintf(stderr, "Stage %s failed for %lu tasks over %llu ticks\n",
+							stageNames[stage], taskCounts[t], horizons[h]);
+						continue;
+					}
+
+					fprintf(fout, "%s,%s,%s,%lu,%llu,%.2f,%llu,%ld,%.9f,%.3f,%.3f,%ld\n",
+						label, layoutNames[settings.layout], stageNames[stage],
+						taskCounts[t], horizons[h], utilizations[u], (unsigned long long)jobs, result.reps,
+						result.seconds, result.seconds * 1e9 / horizons[h], result.seconds * 1e9 / jobs,
+						result.peakKib);
+					fflush(fout);
+				}
+			}
+		}
+		printf("Benchmarked %lu tasks\n", taskCounts[t]);
+	}
+
+	remove(planFile);
+	fclose(fout);
+	return 0;
+}
@@ -2,269 +2,1524 @@
 #include "reporter.h"
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
-typedef struct {
+// A pending event on the timer wheel: a task's next release or a job's deadline
+typedef struct Timer {
+	uint64_t time;
+	struct Timer* next;
+	struct Timer** link; // the pointer to this timer in its slot's list (NULL => not pending)
+	struct Job* job; // the job whose deadline this is, for a release the task's job in flight (NULL => none)
+	uint16_t slot; // level * WHEEL_SLOTS + slot while pending
+	bool release;
+} Timer;
+
+typedef struct Job {
 	PeriodicTask* genericTask;
 	PeriodicTask* periodicTask;
 	AperiodicTask* aperiodicTask;
 
-	uint16_t runtime;
-	uint16_t deadline;
-	uint16_t release;
+	simtime_t runtime;
+	uint64_t deadline; // can lie past the end of simtime_t when the horizon is near its limit
+	simtime_t release;
+
+	// Order in which the job entered the ready queue, breaks deadline ties in favor of the most recent arrival
+	uint64_t order;
+
+	// Global scheduling only: the CPU the job last ran on (NO_CPU => hasn't run) and its place in the running set
+	uint16_t cpu;
+	uint16_t slot;
+
+	// Fires at the deadline, which marks the job expired until the loop deals with it
+	// A periodic job's deadline is its task's next release, so that release's timer fires for it instead of expiry
+	Timer expiry;
+	Timer* timer;
+	bool expired;
+
+	// Link in the pool's free list once the job is finished
+	struct Job* next;
 } Job;
 
-typedef struct ListNode {
-	Job* value;
-	struct ListNode* next;
-	struct ListNode* prev;
-} ListNode;
+// Jobs are carved out of a single slab sized from the plan, finished jobs go on a free list for reuse
+typedef struct {
+	Job* slab;
+	size_t capacity;
+	size_t used;
+	Job* freeList;
+} JobPool;
+
+// Job.cpu of a job which hasn't run on any CPU yet
+#define NO_CPU UINT16_MAX
+
+// Kept between runs so repeated simulations only allocate when a plan needs more jobs than any before it
+// One per thread so batch workers can simulate side by side
+static _Thread_local JobPool jobPool = { NULL, 0, 0, NULL };
+
+// Each level of the timer wheel splits time into 64 slots, 11 levels cover the whole of a 64-bit time
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_LEVELS 11
+
+// Most tasks releasing at once whose sources are put in order by insertion rather than qsort
+#define WHEEL_SORT_INSERTION 16
+
+// Hierarchical timing wheel of the pending releases and deadlines
+// A timer sits on the level of the highest 6-bit group in which its time differs from the wheel's, in the slot of
+// that group's value, and moves down a level whenever the wheel reaches its slot, so arming one and firing it are
+// O(1) amortized and the memory is one timer per task and per job in flight whatever the horizon
+typedef struct {
+	Timer* slots[WHEEL_LEVELS * WHEEL_SLOTS];
+	uint64_t occupied[WHEEL_LEVELS]; // one bit per non-empty slot
+	uint16_t levels; // one bit per level with a non-empty slot
+	uint64_t now; // no pending timer is earlier, the levels are relative to it
+	uint64_t next; // nor is any earlier than this, the last time found by NextTimer unless one was armed before it
+	uint64_t fired; // every timer before this time has fired
+
+	// The next release of each task, periodic tasks are sources [0, pCount), aperiodic tasks follow in plan order
+	// A task with no release left within the duration has its time at UINT64_MAX
+	// Periodic releases are kept up to the duration itself, as the deadline of the job before them
+	Timer* releases;
+
+	// Sources whose release fired, in source order (the order jobs used to be created in) until they're released
+	taskid_t* due;
+	taskid_t dueCount;
+} TimerWheel;
 
-static inline void CleanNode(ListNode* node) {
-	free(node->value);
-	free(node);
+// Binary min-heap of waiting jobs keyed on (deadline, most recent order)
+typedef struct {
+	Job** jobs;
+	uint32_t count;
+	uint32_t capacity;
+	uint64_t order;
+} ReadyQueue;
+
+// Jobs on the CPUs of a global simulation, a binary max-heap on the ready queue's key so the job to preempt is on top
+// Each job knows its slot, so one which finishes can be taken out from anywhere
+typedef struct {
+	Job** jobs;
+	uint16_t count;
+} RunningSet;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Empties the pool (every job handed out before is gone) and makes room for at least the given number of jobs         |
+//---------------------------------------------------------------------------------------------------------------------+
+static void ResetPool(JobPool* pool, size_t capacity) {
+	if (capacity > pool->capacity) {
+		free(pool->slab);
+		pool->slab = (Job*)malloc(sizeof(Job) * capacity);
+		pool->capacity = capacity;
+	}
+	pool->used = 0;
+	pool->freeList = NULL;
 }
 
 //---------------------------------------------------------------------------------------------------------------------+
-// Generates a basic earliest deadline first schedule                                                                  |
+// Hands out an unused job from the pool, which must have been reset with enough capacity                              |
 //---------------------------------------------------------------------------------------------------------------------+
-Schedule* EdfSimulation(SimPlan* plan) {
-	Schedule* sched = MakeSchedule(plan);
+static inline Job* AllocJob(JobPool* pool) {
+	if (pool->freeList != NULL) {
+		Job* job = pool->freeList;
+		pool->freeList = job->next;
+		return job;
+	}
+	return pool->slab + (pool->used++);
+}
 
-	ListNode** releaseSchedule = (ListNode**)calloc(sizeof(ListNode*), sched->duration);
-
-	// Fill the release schedule with all periodic tasks
-	for (uint8_t pTask = 0; pTask < plan->pCount; ++pTask) {
-		PeriodicTask* task = (plan->pTasks) + pTask;
-		uint16_t release = 0;
-		while (release < sched->duration) {
-			// Create the job
-			Job* job = (Job*)malloc(sizeof(Job));
-			job->genericTask = task;
-			job->periodicTask = task;
-			job->aperiodicTask = NULL;
-			job->runtime = task->C;
-			job->release = release;
-
-			// Insert into the release schedule
-			ListNode* node = (ListNode*)malloc(sizeof(ListNode));
-			node->value = job;
-			node->prev = NULL;
-			node->next = releaseSchedule[release];
-			if (node->next != NULL) {
-				node->next->prev = node;
-			}
-			releaseSchedule[release] = node;
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns a finished job to the pool                                                                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void FreeJob(JobPool* pool, Job* job) {
+	job->next = pool->freeList;
+	pool->freeList = job;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - sets up an empty timer wheel at the given time, with no release pending for any task                       |
+// The wheel itself lives on the caller's stack, only the timers of the tasks are allocated                            |
+//---------------------------------------------------------------------------------------------------------------------+
+static void MakeWheel(TimerWheel* wheel, SimPlan* plan, uint64_t now) {
+	memset(wheel, 0, sizeof(TimerWheel));
+	wheel->now = now;
+	wheel->next = now;
+	wheel->fired = now;
+	wheel->releases = (Timer*)calloc(plan->tasks + 1, sizeof(Timer));
+	for (taskid_t source = 0; source < plan->tasks; ++source) {
+		wheel->releases[source].time = UINT64_MAX;
+		wheel->releases[source].release = true;
+	}
+	wheel->due = (taskid_t*)malloc(sizeof(taskid_t) * (plan->tasks + 1));
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - frees what a timer wheel allocated (the timers of jobs in flight belong to the jobs)                       |
+//---------------------------------------------------------------------------------------------------------------------+
+static void CleanWheel(TimerWheel* wheel) {
+	free(wheel->releases);
+	free(wheel->due);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - links a timer into the slot its time falls in, which must not be before the wheel's time                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void InsertTimer(TimerWheel* wheel, Timer* timer) {
+	COUNT(queueOps, 1);
+	uint64_t differ = timer->time ^ wheel->now;
+	unsigned level = differ == 0 ? 0 : (63 - (unsigned)__builtin_clzll(differ)) / WHEEL_BITS;
+	unsigned slot = (unsigned)(timer->time >> (level * WHEEL_BITS)) & (WHEEL_SLOTS - 1);
+
+	timer->slot = (uint16_t)(level * WHEEL_SLOTS + slot);
+	timer->next = wheel->slots[timer->slot];
+	if (timer->next != NULL) {
+		timer->next->link = &timer->next;
+	}
+	timer->link = wheel->slots + timer->slot;
+	wheel->slots[timer->slot] = timer;
+	wheel->occupied[level] |= (uint64_t)1 << slot;
+	wheel->levels |= (uint16_t)(1 << level);
+	if (timer->time < wheel->next) {
+		wheel->next = timer->time;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - marks a slot of the wheel empty                                                                            |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void ClearSlot(TimerWheel* wheel, unsigned level, unsigned slot) {
+	wheel->occupied[level] &= ~((uint64_t)1 << slot);
+	if (wheel->occupied[level] == 0) {
+		wheel->levels &= (uint16_t)~(1 << level);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - takes a timer off the wheel if it is pending                                                               |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void DisarmTimer(TimerWheel* wheel, Timer* timer) {
+	if (timer->link == NULL) {
+		return;
+	}
+	*timer->link = timer->next;
+	if (timer->next != NULL) {
+		timer->next->link = timer->link;
+	}
+	if (wheel->slots[timer->slot] == NULL) {
+		ClearSlot(wheel, timer->slot / WHEEL_SLOTS, timer->slot % WHEEL_SLOTS);
+	}
+	timer->link = NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - (re)arms a timer for the given time                                                                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void ArmTimer(TimerWheel* wheel, Timer* timer, uint64_t time) {
+	DisarmTimer(wheel, timer);
+	timer->time = time;
+	InsertTimer(wheel, timer);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - (re)arms the timer of an aperiodic job's deadline, one the wheel has already passed expires the job        |
+// right away (a periodic job's deadline never moves and is armed with its task's next release)                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void ArmDeadline(TimerWheel* wheel, Job* job) {
+	if (job->periodicTask != NULL) {
+		return;
+	}
+	job->expired = job->deadline < wheel->fired;
+	if (job->expired) {
+		DisarmTimer(wheel, &job->expiry);
+	}
+	else {
+		ArmTimer(wheel, &job->expiry, job->deadline);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - stops a job's deadline from firing once the job is gone                                                    |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void DisarmDeadline(TimerWheel* wheel, Job* job) {
+	if (!job->timer->release) {
+		DisarmTimer(wheel, job->timer);
+	}
+	else if (job->timer->job == job) {
+		job->timer->job = NULL;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - returns the time of the earliest pending timer (UINT64_MAX => none)                                        |
+// When that timer is on an upper level the wheel moves on to the start of its slot, spreading the slot's timers over  |
+// the levels below, until it comes out on the bottom level                                                            |
+// The wheel isn't moved past `limit`, the start of a slot beyond it is returned instead (timers may still be armed    |
+// from the limit on)                                                                                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static uint64_t NextTimer(TimerWheel* wheel, uint64_t limit) {
+	for (;;) {
+		if (wheel->levels == 0) {
+			wheel->next = UINT64_MAX;
+			return UINT64_MAX;
+		}
+		unsigned level = (unsigned)__builtin_ctz(wheel->levels);
+
+		// Every timer on a level is earlier than those on the levels above, and the lowest slot holds the earliest
+		unsigned slot = (unsigned)__builtin_ctzll(wheel->occupied[level]);
+		if (level == 0) {
+			wheel->next = (wheel->now & ~(uint64_t)(WHEEL_SLOTS - 1)) | slot;
+			return wheel->next;
+		}
+
+		unsigned shift = level * WHEEL_BITS;
+		uint64_t above = shift + WHEEL_BITS < 64 ? (wheel->now >> (shift + WHEEL_BITS)) << (shift + WHEEL_BITS) : 0;
+		uint64_t start = above | ((uint64_t)slot << shift);
+		if (start > limit) {
+			wheel->next = start;
+			return start;
+		}
+		wheel->now = start;
+
+		Timer* timer = wheel->slots[level * WHEEL_SLOTS + slot];
+		wheel->slots[level * WHEEL_SLOTS + slot] = NULL;
+		ClearSlot(wheel, level, slot);
+		while (timer != NULL) {
+			Timer* next = timer->next;
+			InsertTimer(wheel, timer);
+			timer = next;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - qsort comparison of release sources                                                                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static int CompareSources(const void* a, const void* b) {
+	taskid_t x = *(taskid_t*)a;
+	taskid_t y = *(taskid_t*)b;
+	return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - fires the timers due at the given time, which must not be past any pending timer                           |
+// Jobs reaching their deadline are marked expired and the tasks releasing are added to the wheel's due sources        |
+//---------------------------------------------------------------------------------------------------------------------+
+static void FireTimers(TimerWheel* wheel, uint64_t time) {
+	if (time < wheel->fired) {
+		return;
+	}
+	wheel->fired = time + 1;
+	if (time < wheel->next || NextTimer(wheel, time) != time) {
+		return;
+	}
+	wheel->now = time;
+
+	unsigned slot = (unsigned)time & (WHEEL_SLOTS - 1);
+	Timer* timer = wheel->slots[slot];
+	wheel->slots[slot] = NULL;
+	ClearSlot(wheel, 0, slot);
+
+	taskid_t released = wheel->dueCount;
+	while (timer != NULL) {
+		timer->link = NULL;
+		if (timer->job != NULL) {
+			timer->job->expired = true;
+		}
+		if (timer->release) {
+			timer->job = NULL;
+			wheel->due[wheel->dueCount++] = (taskid_t)(timer - wheel->releases);
+		}
+		timer = timer->next;
+	}
+
+	// Put the due sources back in order, by insertion for the handful of tasks which usually release together
+	if (wheel->dueCount - released > WHEEL_SORT_INSERTION) {
+		qsort(wheel->due, wheel->dueCount, sizeof(taskid_t), CompareSources);
+		return;
+	}
+	for (taskid_t i = released > 0 ? released : 1; i < wheel->dueCount; ++i) {
+		taskid_t source = wheel->due[i];
+		taskid_t j = i;
+		while (j > 0 && wheel->due[j - 1] > source) {
+			wheel->due[j] = wheel->due[j - 1];
+			--j;
+		}
+		wheel->due[j] = source;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - moves every pending timer the given time later, pushing the wheel's time along with them                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static void ShiftTimers(TimerWheel* wheel, uint64_t shift) {
+	Timer* pending = NULL;
+	for (size_t slot = 0; slot < WHEEL_LEVELS * WHEEL_SLOTS; ++slot) {
+		Timer* timer = wheel->slots[slot];
+		while (timer != NULL) {
+			Timer* next = timer->next;
+			timer->next = pending;
+			pending = timer;
+			timer = next;
+		}
+		wheel->slots[slot] = NULL;
+	}
+	memset(wheel->occupied, 0, sizeof(wheel->occupied));
+	wheel->levels = 0;
+	wheel->now += shift;
+	wheel->next = UINT64_MAX;
+	wheel->fired += shift;
 
-			// Set the deadline last, since it will also update our iterator
-			job->deadline = (release += task->T);
+	while (pending != NULL) {
+		Timer* next = pending->next;
+		pending->time += shift;
+		InsertTimer(wheel, pending);
+		pending = next;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - arms the first release of every task which releases within the plan's duration                             |
+// Each task only keeps its next release on the wheel                                                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static void MakeReleases(TimerWheel* wheel, SimPlan* plan) {
+	MakeWheel(wheel, plan, 0);
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		ArmTimer(wheel, wheel->releases + pTask, 0);
+	}
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		if (plan->aTasks[aTask].r < plan->duration) {
+			ArmTimer(wheel, wheel->releases + plan->pCount + aTask, plan->aTasks[aTask].r);
 		}
 	}
+}
 
-	// Fill the release schedule with all aperiodic tasks
-	for (uint8_t aTask = 0; aTask < plan->aCount; ++aTask) {
-		AperiodicTask* task = (plan->aTasks) + aTask;
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - creates the job of a due source released at the given time and arms its task's next release                |
+// The job's deadline is left for the caller to arm                                                                    |
+//---------------------------------------------------------------------------------------------------------------------+
+static Job* ReleaseJob(TimerWheel* wheel, SimPlan* plan, taskid_t source, simtime_t now) {
+	Timer* release = wheel->releases + source;
+	Job* job = AllocJob(&jobPool);
+	job->release = now;
+	job->expiry.link = NULL;
+	job->expiry.job = job;
+	job->expiry.release = false;
+	job->expired = false;
+	COUNT(jobsReleased, 1);
+
+	if (source < plan->pCount) {
+		PeriodicTask* task = plan->pTasks + source;
+		job->genericTask = task;
+		job->periodicTask = task;
+		job->aperiodicTask = NULL;
+		job->runtime = task->C;
+		job->deadline = now + task->T;
 
-		// Create the job
-		Job* job = (Job*)malloc(sizeof(Job));
+		// The task's next release is this job's deadline, unless that's past the simulation
+		job->timer = release;
+		release->job = job;
+		release->time = UINT64_MAX;
+		if (job->deadline <= plan->duration) {
+			ArmTimer(wheel, release, job->deadline);
+		}
+	}
+	else {
+		AperiodicTask* task = plan->aTasks + (source - plan->pCount);
 		job->genericTask = (PeriodicTask*)task;
 		job->periodicTask = NULL;
 		job->aperiodicTask = task;
 		job->runtime = task->C;
-		job->release = task->r;
-		job->deadline = task->r + APERIODIC_DEADLINE;
+		job->deadline = now + APERIODIC_DEADLINE;
+		job->timer = &job->expiry;
+
+		// Aperiodic tasks only release once
+		release->time = UINT64_MAX;
+	}
 
-		// Insert into the release schedule
-		ListNode* node = (ListNode*)malloc(sizeof(ListNode));
-		node->value = job;
-		node->prev = NULL;
-		node->next = releaseSchedule[task->r];
-		if (node->next != NULL) {
-			node->next->prev = node;
+	return job;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - true when job a should run before job b                                                                    |
+// Equal deadlines go to the job which entered the queue last, matching the front-first scan of the old wait list      |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline bool JobBefore(Job* a, Job* b) {
+	return a->deadline < b->deadline || (a->deadline == b->deadline && a->order > b->order);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Inserts a job into the ready queue, sifting it up to its place in the heap                                          |
+//---------------------------------------------------------------------------------------------------------------------+
+static void PushJob(ReadyQueue* queue, Job* job) {
+	COUNT(queueOps, 1);
+	if (queue->count == queue->capacity) {
+		queue->capacity = queue->capacity == 0 ? 16 : queue->capacity * 2;
+		queue->jobs = (Job**)realloc(queue->jobs, sizeof(Job*) * queue->capacity);
+	}
+
+	uint32_t i = queue->count++;
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+		if (!JobBefore(job, queue->jobs[parent])) {
+			break;
 		}
-		releaseSchedule[task->r] = node;
+		queue->jobs[i] = queue->jobs[parent];
+		i = parent;
 	}
+	queue->jobs[i] = job;
+}
 
-	// Currently running task
-	ListNode* active = NULL;
+//---------------------------------------------------------------------------------------------------------------------+
+// Removes and returns the earliest deadline job in the ready queue (NULL when empty)                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static Job* PopJob(ReadyQueue* queue) {
+	if (queue->count == 0) {
+		return NULL;
+	}
+	COUNT(queueOps, 1);
 
-	// List of waiting tasks
-	ListNode* wait = NULL;
+	Job* top = queue->jobs[0];
+	Job* last = queue->jobs[--queue->count];
+
+	// Sift the last job down from the root
+	uint32_t i = 0;
+	for (;;) {
+		uint32_t child = (2 * i) + 1;
+		if (child >= queue->count) {
+			break;
+		}
+		if (child + 1 < queue->count && JobBefore(queue->jobs[child + 1], queue->jobs[child])) {
+			++child;
+		}
+		if (!JobBefore(queue->jobs[child], last)) {
+			break;
+		}
+		queue->jobs[i] = queue->jobs[child];
+		i = child;
+	}
+	queue->jobs[i] = last;
+
+	return top;
+}
+
+// A running or waiting periodic job as seen from a hyperperiod boundary
+typedef struct {
+	PeriodicTask* task;
+	simtime_t runtime;
+	simtime_t slack; // deadline relative to the boundary
+} PendingJob;
+
+// The pending work at a hyperperiod boundary: the active job first, then the waiting jobs in the order they would run
+typedef struct {
+	PendingJob* jobs;
+	uint32_t count;
+	uint32_t capacity;
+	simtime_t time;
+} Snapshot;
+
+// The server EDF runs aperiodic jobs under, kind SERVER_NONE when each simply gets APERIODIC_DEADLINE
+typedef struct {
+	uint8_t kind;
+	simtime_t budget;
+	simtime_t period;
+	uint64_t deadline; // TBS: the last deadline handed out, CBS: the server's current deadline
+	uint64_t remaining; // CBS only: budget left before the deadline moves on
+
+	// CBS only: the job the server is running (NULL => idle), then the jobs waiting for it in arrival order
+	Job* served;
+	Job** queue;
+	taskid_t head;
+	taskid_t tail;
+
+	uint64_t used;
+} EdfServer;
+
+// Most states a resumable simulation saves, spread evenly over the plan's duration
+#define EDF_SAVED_STATES 64
+
+// A job in flight when a state was saved, by its release queue source rather than a pointer into the plan
+typedef struct {
+	taskid_t source;
+	simtime_t runtime;
+	simtime_t release;
+	uint64_t deadline;
+	uint64_t order;
+} SavedJob;
+
+// The state of the event loop at the top of a pass, before anything at `time` is decided
+typedef struct {
+	simtime_t time;
+	uint64_t order; // the ready queue's next order
+	uint64_t aperiodicResponseTimes;
+	size_t firstJob; // index into SavedStates.jobs, the active job (if any) comes first
+	uint32_t jobCount;
+	bool active;
+} SavedState;
+
+// States saved along a resumable simulation (see EdfResimulation), in time order
+// Only the periodic releases are kept (pCount per state in task order), aperiodic ones are read from the plan instead
+typedef struct SavedStates {
+	SavedState* states;
+	size_t count;
+	size_t capacity;
+	uint64_t* releases;
+	SavedJob* jobs;
+	size_t jobCount;
+	size_t jobCapacity;
+	taskid_t pCount;
+	simtime_t interval;
+	uint64_t next; // the earliest time the next state is saved at
+} SavedStates;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - qsort comparison putting jobs in the order the ready queue would pop them                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static int CompareJobs(const void* a, const void* b) {
+	Job* x = *(Job**)a;
+	Job* y = *(Job**)b;
+	return JobBefore(x, y) ? -1 : (JobBefore(y, x) ? 1 : 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Records the pending work at the given time, returns false (leaving snap unusable) if an aperiodic job is pending    |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool TakeSnapshot(Snapshot* snap, Job* active, ReadyQueue* wait, simtime_t now) {
+	snap->count = 0;
+	snap->time = now;
+
+	if (active != NULL && active->aperiodicTask != NULL) {
+		return false;
+	}
+
+	uint32_t count = wait->count + (active != NULL ? 1 : 0);
+	if (count > snap->capacity) {
+		snap->capacity = count;
+		snap->jobs = (PendingJob*)realloc(snap->jobs, sizeof(PendingJob) * count);
+	}
+
+	Job** order = (Job**)malloc(sizeof(Job*) * (count + 1));
+	order[0] = active;
+	memcpy(order + 1, wait->jobs, sizeof(Job*) * wait->count);
+	qsort(order + 1, wait->count, sizeof(Job*), CompareJobs);
+
+	for (uint32_t i = active != NULL ? 0 : 1; i <= wait->count; ++i) {
+		if (order[i]->aperiodicTask != NULL) {
+			free(order);
+			return false;
+		}
+
+		PendingJob* job = snap->jobs + (snap->count++);
+		job->task = order[i]->periodicTask;
+		job->runtime = order[i]->runtime;
+		job->slack = order[i]->deadline - now;
+	}
+
+	free(order);
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - true when two snapshots hold the same pending work relative to their own times                             |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool SameSnapshot(Snapshot* a, Snapshot* b) {
+	if (a->count != b->count) {
+		return false;
+	}
+	for (uint32_t i = 0; i < a->count; ++i) {
+		if (a->jobs[i].task != b->jobs[i].task ||
+			a->jobs[i].runtime != b->jobs[i].runtime ||
+			a->jobs[i].slack != b->jobs[i].slack) {
+			return false;
+		}
+	}
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - the release queue source of a job's task                                                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline taskid_t JobSource(SimPlan* plan, Job* job) {
+	if (job->periodicTask != NULL) {
+		return (taskid_t)(job->periodicTask - plan->pTasks);
+	}
+	return plan->pCount + (taskid_t)(job->aperiodicTask - plan->aTasks);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Creates an empty set of saved states for a resumable simulation of the given plan                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static SavedStates* MakeSavedStates(SimPlan* plan) {
+	SavedStates* saved = (SavedStates*)calloc(sizeof(SavedStates), 1);
+	saved->capacity = EDF_SAVED_STATES;
+	saved->states = (SavedState*)malloc(sizeof(SavedState) * saved->capacity);
+	saved->releases = (uint64_t*)malloc(sizeof(uint64_t) * (saved->capacity * plan->pCount + 1));
+	saved->pCount = plan->pCount;
+	saved->interval = (simtime_t)((plan->duration + (uint64_t)EDF_SAVED_STATES - 1) / EDF_SAVED_STATES);
+	if (saved->interval == 0) {
+		saved->interval = 1;
+	}
+	return saved;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Appropriately frees the memory associated with the given saved states (NULL is fine)                                |
+//---------------------------------------------------------------------------------------------------------------------+
+void CleanSavedStates(SavedStates* saved) {
+	if (saved == NULL) {
+		return;
+	}
+	free(saved->states);
+	free(saved->releases);
+	free(saved->jobs);
+	free(saved);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Saves the state of the event loop at the top of a pass, before anything at `now` is decided                         |
+//---------------------------------------------------------------------------------------------------------------------+
+static void SaveState(SavedStates* saved, SimPlan* plan, TimerWheel* wheel, Job* active, ReadyQueue* wait,
+	simtime_t now, uint64_t aperiodicResponseTimes) {
+	if (saved->count == saved->capacity) {
+		return;
+	}
+
+	SavedState* state = saved->states + saved->count;
+	state->time = now;
+	state->order = wait->order;
+	state->aperiodicResponseTimes = aperiodicResponseTimes;
+	state->firstJob = saved->jobCount;
+	state->jobCount = wait->count + (active != NULL ? 1 : 0);
+	state->active = active != NULL;
+
+	// Tasks which release no more by the end of the duration are left at UINT64_MAX
+	uint64_t* releases = saved->releases + (saved->count * saved->pCount);
+	for (taskid_t pTask = 0; pTask < saved->pCount; ++pTask) {
+		releases[pTask] = wheel->releases[pTask].time;
+	}
+
+	if (saved->jobCount + state->jobCount > saved->jobCapacity) {
+		saved->jobCapacity = saved->jobCapacity * 2 > saved->jobCount + state->jobCount ?
+			saved->jobCapacity * 2 : saved->jobCount + state->jobCount;
+		saved->jobs = (SavedJob*)realloc(saved->jobs, sizeof(SavedJob) * saved->jobCapacity);
+	}
+	for (uint32_t i = 0; i < state->jobCount; ++i) {
+		Job* job = active != NULL ? (i == 0 ? active : wait->jobs[i - 1]) : wait->jobs[i];
+		SavedJob* copy = saved->jobs + (saved->jobCount++);
+		copy->source = JobSource(plan, job);
+		copy->runtime = job->runtime;
+		copy->release = job->release;
+		copy->deadline = job->deadline;
+		copy->order = job->order;
+	}
+
+	++saved->count;
+	saved->next = (uint64_t)now + saved->interval;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - sets up the plan's server when it is one EDF runs (TBS or CBS), otherwise one of kind SERVER_NONE          |
+//---------------------------------------------------------------------------------------------------------------------+
+static EdfServer MakeEdfServer(SimPlan* plan) {
+	EdfServer server;
+	memset(&server, 0, sizeof(EdfServer));
+	if (plan->server.kind == SERVER_TOTAL_BANDWIDTH || plan->server.kind == SERVER_CONSTANT_BANDWIDTH) {
+		server.kind = plan->server.kind;
+		server.budget = plan->server.budget;
+		server.period = plan->server.period;
+	}
+	if (server.kind == SERVER_CONSTANT_BANDWIDTH) {
+		server.queue = (Job**)malloc(sizeof(Job*) * (plan->aCount + 1));
+	}
+	return server;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - gives a constant bandwidth server a full budget with its deadline a period later                           |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void RechargeServer(EdfServer* server) {
+	server->deadline += server->period;
+	server->remaining = server->budget;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - hands a released aperiodic job to the server, which gives it the deadline it is scheduled by               |
+// Returns false when the job has to wait for the constant bandwidth server to finish the jobs before it               |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool ServeAperiodic(EdfServer* server, Job* job, simtime_t now) {
+	if (server->kind == SERVER_TOTAL_BANDWIDTH) {
+		// d = max(r, last d) + C / Us, rounded up so the bandwidth is never exceeded
+		if (server->deadline < now) {
+			server->deadline = now;
+		}
+		server->deadline += ((uint64_t)job->runtime * server->period + server->budget - 1) / server->budget;
+		job->deadline = server->deadline;
+		return true;
+	}
+
+	if (server->served != NULL) {
+		server->queue[server->tail++] = job;
+		return false;
+	}
+
+	// An idle server keeps its deadline only while what's left of its budget fits its bandwidth until then
+	if (server->deadline <= now ||
+		server->remaining * server->period >= (server->deadline - now) * server->budget) {
+		server->deadline = now;
+		server->remaining = 0;
+	}
+	if (server->remaining == 0) {
+		RechargeServer(server);
+	}
+	server->served = job;
+	job->deadline = server->deadline;
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - moves the constant bandwidth server on to its next waiting job once the one it served is done              |
+// Returns the job (with its deadline set) to queue, or NULL when the server goes idle                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+static Job* ServeNext(EdfServer* server) {
+	if (server->head == server->tail) {
+		server->served = NULL;
+		return NULL;
+	}
+	if (server->remaining == 0) {
+		RechargeServer(server);
+	}
+	server->served = server->queue[server->head++];
+	server->served->deadline = server->deadline;
+	return server->served;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - runs the event loop of an earliest deadline first simulation from the given state to the end               |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RunEdf(SimPlan* plan, Schedule* sched, TimerWheel* wheel, Job* active, ReadyQueue wait, simtime_t now) {
+	// When extrapolating, compare the pending work at each hyperperiod boundary reached after the last aperiodic release
+	simtime_t hyperperiod = plan->settings.extrapolate && plan->settings.layout != LAYOUT_COUNTERS ?
+		PlanHyperperiod(plan) : 0;
+	simtime_t lastAperiodic = 0;
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		if (plan->aTasks[aTask].r > lastAperiodic) {
+			lastAperiodic = plan->aTasks[aTask].r;
+		}
+	}
+	Snapshot snapshots[2] = { { NULL, 0, 0, 0 }, { NULL, 0, 0, 0 } };
+	Snapshot* prevSnapshot = snapshots;
+	Snapshot* nextSnapshot = snapshots + 1;
+	bool havePrevSnapshot = false;
+	EdfServer server = MakeEdfServer(plan);
 
 	// There are two points of decision on which task executes at any given time:
 	//   1 - when a task is released (preempt if one has an earlier deadline than the active task)
-	//   2 - when a task completes (or stops due to missing its deadline) find the earliest deadline in wait
-	for (uint16_t now = 0; now < sched->duration; ++now) {
-		char* flagsPrev = sched->flags + ((now - 1) * sched->tasks);
-		char* flagsNow = sched->flags + (now * sched->tasks);
+	//   2 - when a task completes (or stops due to missing its deadline) take the earliest deadline from wait
+	// Nothing can change between those instants, so time jumps from one to the next instead of ticking through
+	// Releases and deadlines are both timers on the wheel, a deadline firing is what marks a job as missing it
+#ifdef SIM_STATS
+	simtime_t start = now;
+	simtime_t copied = 0; // ticks filled in by RepeatSchedule rather than simulated
+#endif
+	while (now < sched->duration && !sched->stopped) {
+		if (sched->states != NULL && now >= sched->states->next) {
+			SaveState(sched->states, plan, wheel, active, &wait, now, sched->aperiodicResponseTimes);
+		}
 
 		// First decision point: one or more tasks have been released
-		if (releaseSchedule[now] != NULL) {
-			ListNode* released = releaseSchedule[now];
-			releaseSchedule[now] = NULL;
-
-			ListNode* EarliestDeadline = active;
-			ListNode* listIterator = released;
-			if (active == NULL) {
-				EarliestDeadline = listIterator;
-				listIterator = listIterator->next;
-			}
+		FireTimers(wheel, now);
+		if (wheel->dueCount > 0) {
+			// The active task would have entered wait just ahead of this release
+			uint64_t activeOrder = wait.order++;
 
-			// Find the earliest deadline among active and the released tasks
-			// since active is earlier than anything in wait we can ignore wait
-			while (listIterator != NULL) {
-				if (listIterator->value->deadline < EarliestDeadline->value->deadline) {
-					EarliestDeadline = listIterator;
+			// Queue the released jobs in source order so the last one wins deadline ties
+			for (taskid_t due = 0; due < wheel->dueCount; ++due) {
+				Job* job = ReleaseJob(wheel, plan, wheel->due[due], now);
+				if (job->aperiodicTask != NULL && server.kind != SERVER_NONE && !ServeAperiodic(&server, job, now)) {
+					continue;
 				}
-				listIterator = listIterator->next;
+				ArmDeadline(wheel, job);
+				job->order = wait.order++;
+				PushJob(&wait, job);
 			}
+			wheel->dueCount = 0;
 
 			// There is a newly released job with an earlier deadline, preempt the active task
-			if (EarliestDeadline != active) {
-				ListNode* next = EarliestDeadline->next;
-				ListNode* prev = EarliestDeadline->prev;
-
-				// Remove Earliest from the list
-				if (next != NULL) { next->prev = prev; }
-				if (prev != NULL) { prev->next = next; }
-				EarliestDeadline->next = EarliestDeadline->prev = NULL;
-
-				// If the head is the earliest deadline shift the list which will later be merged into wait
-				if (released == EarliestDeadline) {
-					released = next;
-				}
-
-				// Preempt active and add it to the wait list
+			// Since active is earlier than anything already in wait only the released jobs can do this
+			if (wait.count > 0 && (active == NULL || wait.jobs[0]->deadline < active->deadline)) {
 				if (active != NULL) {
-					active->next = wait;
-					if (wait != NULL) {
-						wait->prev = active;
-					}
-
 					// Make sure we didn't just switch to active in a previous iteration of the loop (not preemption)
-					if (sched->activeTask[now - 1] == active->value->genericTask->columnIndex) {
-						flagsPrev[active->value->genericTask->taskIndex] = STATUS_PREEMPTED;
+					if (GetActive(sched, now - 1) == active->genericTask->columnIndex) {
+						SetStatus(sched, now - 1, active->genericTask->taskIndex, STATUS_PREEMPTED);
+						COUNT(preemptions, 1);
 					}
 
-					wait = active;
+					active->order = activeOrder;
+					PushJob(&wait, active);
 				}
 
-				active = EarliestDeadline;
+				active = PopJob(&wait);
 			}
+		}
 
-			// Add released to wait
-			if (released != NULL) {
-				ListNode* tail = released;
-				while (tail->next != NULL) {
-					tail = tail->next;
-				}
+		// Once the pending work at a hyperperiod boundary matches the previous boundary (with no aperiodic work left)
+		// every following hyperperiod is a copy of the last one, so copy it over all that fit and jump past them
+		if (hyperperiod != 0 && now != 0 && now % hyperperiod == 0 && now >= lastAperiodic) {
+			if (TakeSnapshot(nextSnapshot, active, &wait, now)) {
+				if (havePrevSnapshot && prevSnapshot->time == now - hyperperiod && SameSnapshot(prevSnapshot, nextSnapshot)) {
+					simtime_t shift = ((sched->duration - now) / hyperperiod) * hyperperiod;
+					RepeatSchedule(sched, now - hyperperiod, hyperperiod, now + shift, sched->tasks);
 
-				tail->next = wait;
-				if (wait != NULL) {
-					wait->prev = tail;
+					// Only periodic releases are left, and like the pending jobs they move past the copied hyperperiods
+					// A uniform shift keeps the ready heap ordered (releases pushed past the end simply never come up)
+					ShiftTimers(wheel, shift);
+					if (active != NULL) {
+						active->deadline += shift;
+						active->release += shift;
+					}
+					for (uint32_t job = 0; job < wait.count; ++job) {
+						wait.jobs[job]->deadline += shift;
+						wait.jobs[job]->release += shift;
+					}
+					now += shift;
+#ifdef SIM_STATS
+					copied = shift;
+#endif
+
+					// There is less than a hyperperiod left, nothing more to extrapolate
+					hyperperiod = 0;
+					if (now >= sched->duration) {
+						break;
+					}
+				}
+				else {
+					Snapshot* temp = prevSnapshot;
+					prevSnapshot = nextSnapshot;
+					nextSnapshot = temp;
+					havePrevSnapshot = true;
 				}
-				wait = released;
+			}
+			else {
+				havePrevSnapshot = false;
 			}
 		}
 
-		// Execute the active task - potentially deal with the second decision point: closeJob
-		if (active != NULL) {
-			sched->activeTask[now] = active->value->genericTask->columnIndex;
-			active->value->runtime--;
+		// The next timer, a release which may preempt whatever runs from now on or the active job's deadline
+		// (any job waiting is due no earlier)
+		uint64_t nextTimer = NextTimer(wheel, UINT64_MAX);
+		simtime_t nextEvent = nextTimer < sched->duration ? (simtime_t)nextTimer : sched->duration;
+
+		// Idle until the next release
+		if (active == NULL) {
+			now = nextEvent;
+			continue;
+		}
+
+		// Execute the active task up to the next decision point: its completion, its deadline or the next release
+		{
+			uint64_t end = nextEvent;
+			if (active->runtime < end - now) {
+				end = now + active->runtime;
+			}
+			if (active == server.served && server.remaining < end - now) {
+				end = now + server.remaining;
+			}
+
+			SetActive(sched, now, (simtime_t)end, active->genericTask->columnIndex);
+			active->runtime -= end - now;
+			if (active->aperiodicTask != NULL && server.kind != SERVER_NONE) {
+				server.used += end - now;
+				if (active == server.served) {
+					server.remaining -= end - now;
+				}
+			}
+
+			// The remaining checks are made from the last tick of the run, after the deadlines at its end have fired
+			now = (simtime_t)(end - 1);
+			FireTimers(wheel, end);
+		}
 
+		// Potentially deal with the second decision point: closeJob
+		{
 			bool closeJob = false;
+			Job* postponed = NULL;
 
 			// Job's finished (imagine an SCV's voice from starcraft)
-			if (active->value->runtime == 0) {
+			if (active->runtime == 0) {
 				closeJob = true;
 			}
 
+			// The constant bandwidth server ran out of budget (or time), it postpones its deadline rather than miss it
+			else if (active == server.served && (server.remaining == 0 || active->expired)) {
+				RechargeServer(&server);
+				active->deadline = server.deadline;
+				ArmDeadline(wheel, active);
+				active->order = wait.order++;
+				PushJob(&wait, active);
+				postponed = active;
+			}
+
 			// Missed deadline
-			else if (active->value->deadline == now + 1) {
-				flagsNow[active->value->genericTask->taskIndex] = STATUS_OVERDUE;
+			else if (active->expired) {
+				SetStatus(sched, now, active->genericTask->taskIndex, STATUS_OVERDUE);
 				closeJob = true;
 			}
 
 			// if finished or will miss deadline pull next active from wait
 			if (closeJob) {
 				// Record the response time of aperiodic tasks
-				if (active->value->aperiodicTask != NULL) {
-					sched->aperiodicResponseTimes += now - active->value->release;
+				if (active->aperiodicTask != NULL) {
+					sched->aperiodicResponseTimes += now - active->release;
 				}
 
-				// Cleanup the released job
-				CleanNode(active);
-				active = NULL;
+				// The constant bandwidth server carries on with the next job waiting for it
+				if (active == server.served && ServeNext(&server) != NULL) {
+					ArmDeadline(wheel, server.served);
+					server.served->order = wait.order++;
+					PushJob(&wait, server.served);
+				}
 
+				// Cleanup the released job
+				DisarmDeadline(wheel, active);
+				FreeJob(&jobPool, active);
+			}
+			if (closeJob || postponed != NULL) {
 				// Loop to make sure we handle multiple missed multiple deadlines as long as there are jobs in wait
-				while (wait != NULL) {
-					ListNode* EarliestDeadline = wait;
-					ListNode* listIterator = wait->next;
-
-					// Find the earliest deadline among waiting tasks
-					while (listIterator != NULL) {
-						if (listIterator->value->deadline < EarliestDeadline->value->deadline) {
-							EarliestDeadline = listIterator;
-						}
-						listIterator = listIterator->next;
+				while ((active = PopJob(&wait)) != NULL) {
+					// Check to make sure active is not going to miss its deadline as it's about to start
+					if (!active->expired) {
+						break;
 					}
 
-					// remove EarliestDeadline from the list
-					ListNode* next = EarliestDeadline->next;
-					ListNode* prev = EarliestDeadline->prev;
-					if (next != NULL) { next->prev = prev; }
-					if (prev != NULL) { prev->next = next; }
-					EarliestDeadline->next = EarliestDeadline->prev = NULL;
-
-					// If the head is the earliest deadline shift the list
-					if (wait == EarliestDeadline) {
-						wait = next;
+					// A server job which waited out its deadline is postponed like one out of budget
+					if (active == server.served) {
+						RechargeServer(&server);
+						active->deadline = server.deadline;
+						ArmDeadline(wheel, active);
+						active->order = wait.order++;
+						PushJob(&wait, active);
+						continue;
 					}
 
-					active = EarliestDeadline;
+					SetStatus(sched, now, active->genericTask->taskIndex, STATUS_OVERDUE);
 
-					// Check to make sure active is not going to miss its deadline as it's about to start
-					if (active->value->deadline == now + 1) {
-						flagsNow[active->value->genericTask->taskIndex] = STATUS_OVERDUE;
+					// Record the response time of aperiodic tasks
+					if (active->aperiodicTask != NULL) {
+						sched->aperiodicResponseTimes += now - active->release;
+					}
 
-						// Record the response time of aperiodic tasks
-						if (active->value->aperiodicTask != NULL) {
-							sched->aperiodicResponseTimes += now - active->value->release;
-						}
+					// Cleanup the released job
+					FreeJob(&jobPool, active);
+				}
 
-						// Cleanup the released job
-						CleanNode(active);
-						active = NULL;
-					}
-					else {
-						break;
-					}
+				// The postponed job doesn't carry on, so it was preempted
+				if (postponed != NULL && active != postponed) {
+					SetStatus(sched, now, postponed->genericTask->taskIndex, STATUS_PREEMPTED);
+					COUNT(preemptions, 1);
 				}
 			}
 		}
+
+		++now;
 	}
 
-	// Cleanup any jobs that didn't finish
-	if (active == NULL && wait != NULL) {
-		active = wait;
-		wait = wait->next;
+	// Cleanup any jobs that didn't finish (a simulation stopped at its first miss only counts the time it simulated)
+	simtime_t end = sched->stopped ? now : sched->duration;
+	if (active == NULL) {
+		active = PopJob(&wait);
 	}
 	while (active != NULL) {
 		// Record the response time of aperiodic tasks
-		if (active->value->aperiodicTask != NULL) {
-			sched->aperiodicResponseTimes += sched->duration - active->value->release;
+		if (active->aperiodicTask != NULL) {
+			sched->aperiodicResponseTimes += end - active->release;
 		}
 
 		// Cleanup the released job
-		CleanNode(active);
-		active = wait;
-		if (wait != NULL) {
-			wait = wait->next;
+		FreeJob(&jobPool, active);
+		active = PopJob(&wait);
+	}
+	for (taskid_t queued = server.head; queued < server.tail; ++queued) {
+		sched->aperiodicResponseTimes += end - server.queue[queued]->release;
+		FreeJob(&jobPool, server.queue[queued]);
+	}
+	free(wait.jobs);
+	COUNT(ticks, end - copied - start);
+
+	sched->server = server.kind;
+	sched->serverBudget = ServerCapacity(&plan->server, plan->duration);
+	sched->serverUsed = server.used;
+	free(server.queue);
+
+	// Each job has been returned to the pool after entering the closeJob section or the cleanup above
+	// The pool itself is emptied in one shot by the next run
+	CleanWheel(wheel);
+	free(snapshots[0].jobs);
+	free(snapshots[1].jobs);
+
+	FinishSchedule(sched);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - true when the plan's aperiodic jobs run under a server EDF implements (its state isn't saved)              |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline bool EdfServes(SimPlan* plan) {
+	return plan->server.kind == SERVER_TOTAL_BANDWIDTH || plan->server.kind == SERVER_CONSTANT_BANDWIDTH;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Generates a basic earliest deadline first schedule                                                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+Schedule* EdfSimulation(SimPlan* plan) {
+	Schedule* sched = MakeSchedule(plan);
+	if (plan->settings.resumable && !EdfServes(plan) && plan->settings.layout != LAYOUT_COUNTERS) {
+		sched->states = MakeSavedStates(plan);
+	}
+
+	// Jobs are created as they are released and each periodic job is gone by its deadline (the next release of its
+	// task), so there is never more than one job per task in flight
+	ResetPool(&jobPool, plan->tasks);
+
+	TimerWheel wheel;
+	MakeReleases(&wheel, plan);
+
+	// Nothing running and nothing waiting yet
+	ReadyQueue wait = { NULL, 0, 0, 0 };
+	RunEdf(plan, sched, &wheel, NULL, wait, 0);
+	return sched;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Re-simulates a plan after an edit, resuming the previous schedule's simulation instead of starting over            |
+// `plan` is EditPlan(oldPlan, edit) and `previous` the EDF schedule of oldPlan, simulated with settings.resumable     |
+// The simulation resumes from the last state saved before the first tick the edit can change, copying what came       |
+// before it from the previous schedule (which is left as it was), and falls back to a full run when there's no such   |
+// state or the layouts differ                                                                                         |
+//---------------------------------------------------------------------------------------------------------------------+
+Schedule* EdfResimulation(SimPlan* plan, Schedule* previous, SimPlan* oldPlan, PlanEdit* edit) {
+	SavedStates* saved = previous->states;
+	simtime_t from = FirstEditedTick(oldPlan, edit);
+
+	// Whatever happens at the saved time itself may depend on releases at that time, so the state has to be earlier
+	size_t resume = saved != NULL ? saved->count : 0;
+	while (resume > 0 && saved->states[resume - 1].time >= from) {
+		--resume;
+	}
+	if (resume == 0 || EdfServes(plan) || (previous->activeTask != NULL) != (plan->settings.layout == LAYOUT_DENSE) ||
+		previous->duration != plan->duration || saved->pCount != plan->pCount) {
+		return EdfSimulation(plan);
+	}
+	SavedState* state = saved->states + (resume - 1);
+
+	Schedule* sched = ResumeSchedule(plan, previous, state->time);
+	sched->aperiodicResponseTimes = state->aperiodicResponseTimes;
+
+	// The states before the resumed one still hold for the edited plan, the resumed one is saved again as the loop starts
+	if (plan->settings.resumable) {
+		sched->states = MakeSavedStates(plan);
+		SavedState* last = saved->states + (resume - 1);
+		if (resume > 1) {
+			memcpy(sched->states->states, saved->states, sizeof(SavedState) * (resume - 1));
+			memcpy(sched->states->releases, saved->releases, sizeof(uint64_t) * (resume - 1) * saved->pCount);
+		}
+		sched->states->jobCapacity = last->firstJob;
+		sched->states->jobCount = last->firstJob;
+		sched->states->jobs = (SavedJob*)malloc(sizeof(SavedJob) * (last->firstJob + 1));
+		if (last->firstJob > 0) {
+			// No job may have been saved yet, in which case saved->jobs is still NULL
+			memcpy(sched->states->jobs, saved->jobs, sizeof(SavedJob) * last->firstJob);
+		}
+		sched->states->count = resume - 1;
+		sched->states->next = state->time;
+	}
+
+	ResetPool(&jobPool, plan->tasks);
+
+	// Periodic tasks carry on with their next releases, aperiodic ones not yet released come from the edited plan
+	TimerWheel wheel;
+	MakeWheel(&wheel, plan, state->time);
+	uint64_t* releases = saved->releases + ((resume - 1) * saved->pCount);
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		if (releases[pTask] <= plan->duration) {
+			ArmTimer(&wheel, wheel.releases + pTask, releases[pTask]);
+		}
+	}
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		if (plan->aTasks[aTask].r >= state->time && plan->aTasks[aTask].r < plan->duration) {
+			ArmTimer(&wheel, wheel.releases + plan->pCount + aTask, plan->aTasks[aTask].r);
 		}
 	}
 
-	// By the end releaseSchedule is empty because:
-	// Each job has been transfered to wait, then freed one by one after entering the closeJob section
-	free(releaseSchedule);
+	// Jobs in flight, the active one first
+	Job* active = NULL;
+	ReadyQueue wait = { NULL, 0, 0, state->order };
+	for (uint32_t i = 0; i < state->jobCount; ++i) {
+		SavedJob* copy = saved->jobs + (state->firstJob + i);
+		Job* job = AllocJob(&jobPool);
+		if (copy->source < plan->pCount) {
+			job->genericTask = job->periodicTask = plan->pTasks + copy->source;
+			job->aperiodicTask = NULL;
+		}
+		else {
+			job->aperiodicTask = plan->aTasks + (copy->source - plan->pCount);
+			job->genericTask = (PeriodicTask*)job->aperiodicTask;
+			job->periodicTask = NULL;
+		}
+		job->runtime = copy->runtime;
+		job->release = copy->release;
+		job->deadline = copy->deadline;
+		job->order = copy->order;
+		job->cpu = NO_CPU;
+		job->expiry.link = NULL;
+		job->expiry.job = job;
+		job->expiry.release = false;
+		job->timer = job->periodicTask != NULL ? wheel.releases + copy->source : &job->expiry;
+		job->timer->job = job;
+		job->expired = false;
+		ArmDeadline(&wheel, job);
+
+		if (i == 0 && state->active) {
+			active = job;
+		}
+		else {
+			PushJob(&wait, job);
+		}
+	}
 
+	RunEdf(plan, sched, &wheel, active, wait, state->time);
 	return sched;
 }
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - puts a job into the given slot of the running set                                                          |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void PlaceRunning(RunningSet* set, uint16_t i, Job* job) {
+	set->jobs[i] = job;
+	job->slot = i;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - restores the running set's heap order around the job in the given slot                                     |
+//---------------------------------------------------------------------------------------------------------------------+
+static void SiftRunning(RunningSet* set, uint16_t i) {
+	Job* job = set->jobs[i];
+
+	// Up while the parent would run before it
+	while (i > 0) {
+		uint16_t parent = (i - 1) / 2;
+		if (!JobBefore(set->jobs[parent], job)) {
+			break;
+		}
+		PlaceRunning(set, i, set->jobs[parent]);
+		i = parent;
+	}
+
+	// Down while a child would run after it
+	for (;;) {
+		uint32_t child = (2 * (uint32_t)i) + 1;
+		if (child >= set->count) {
+			break;
+		}
+		if (child + 1 < set->count && JobBefore(set->jobs[child], set->jobs[child + 1])) {
+			++child;
+		}
+		if (!JobBefore(job, set->jobs[child])) {
+			break;
+		}
+		PlaceRunning(set, i, set->jobs[child]);
+		i = (uint16_t)child;
+	}
+	PlaceRunning(set, i, job);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - takes a job out of the running set                                                                         |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RemoveRunning(RunningSet* set, Job* job) {
+	COUNT(queueOps, 1);
+	uint16_t i = job->slot;
+	Job* last = set->jobs[--set->count];
+	if (i < set->count) {
+		PlaceRunning(set, i, last);
+		SiftRunning(set, i);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - puts a job on the given CPU, counting a migration when it last ran on another one                          |
+//---------------------------------------------------------------------------------------------------------------------+
+static void Dispatch(MultiSchedule* multi, RunningSet* running, Job** onCpu, uint16_t cpu, Job* job) {
+	if (job->cpu != NO_CPU && job->cpu != cpu) {
+		++multi->migrations[job->genericTask->taskIndex];
+	}
+	job->cpu = cpu;
+	onCpu[cpu] = job;
+
+	COUNT(queueOps, 1);
+	PlaceRunning(running, running->count++, job);
+	SiftRunning(running, job->slot);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - ends a job at the given time, marking it overdue on a lane when it didn't finish                          |
+//---------------------------------------------------------------------------------------------------------------------+
+static void CloseGlobalJob(MultiSchedule* multi, TimerWheel* wheel, Job* job, simtime_t end, Schedule* lane) {
+	DisarmDeadline(wheel, job);
+	if (job->runtime != 0) {
+		SetStatus(lane, end - 1, job->genericTask->taskIndex, STATUS_OVERDUE);
+	}
+
+	// Record the response time of aperiodic tasks
+	if (job->aperiodicTask != NULL) {
+		multi->aperiodicResponseTimes += end - 1 - job->release;
+	}
+
+	FreeJob(&jobPool, job);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - hands the earliest deadline waiting jobs to the idle CPUs, dropping any which are already due             |
+// A job goes back to the CPU it last ran on when that one is idle, otherwise to the lowest numbered idle CPU          |
+//---------------------------------------------------------------------------------------------------------------------+
+static void FillCpus(MultiSchedule* multi, TimerWheel* wheel, ReadyQueue* wait, RunningSet* running, Job** onCpu,
+	simtime_t now) {
+	while (running->count < multi->cpus && wait->count > 0) {
+		Job* job = PopJob(wait);
+
+		uint16_t cpu = job->cpu;
+		if (cpu == NO_CPU || onCpu[cpu] != NULL) {
+			for (cpu = 0; onCpu[cpu] != NULL; ++cpu) {
+			}
+		}
+
+		if (job->expired) {
+			CloseGlobalJob(multi, wheel, job, now, multi->lanes[cpu]);
+			continue;
+		}
+		Dispatch(multi, running, onCpu, cpu, job);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Generates a global earliest deadline first schedule on the given number of CPUs                                     |
+// One ready queue feeds every CPU and jobs migrate freely: whenever a released job has an earlier deadline than the   |
+// latest deadline running, that job is preempted and the CPU it frees goes to the released job                        |
+// Time jumps between releases and completions as in EdfSimulation, which this matches on a single CPU                 |
+//---------------------------------------------------------------------------------------------------------------------+
+MultiSchedule* GlobalEdfSimulation(SimPlan* plan, uint16_t cpus) {
+	MultiSchedule* multi = (MultiSchedule*)calloc(1, sizeof(MultiSchedule));
+	multi->cpus = cpus;
+	multi->lanes = (Schedule**)malloc(sizeof(Schedule*) * cpus);
+	multi->preemptions = (uint64_t*)calloc(plan->tasks + 1, sizeof(uint64_t));
+	multi->migrations = (uint64_t*)calloc(plan->tasks + 1, sizeof(uint64_t));
+	for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+		multi->lanes[cpu] = MakeSchedule(plan);
+
+		// Aperiodic response times belong to the whole run rather than to the CPU a job happened to finish on
+		multi->lanes[cpu]->aCount = 0;
+	}
+
+	ResetPool(&jobPool, plan->tasks);
+	TimerWheel wheel;
+	MakeReleases(&wheel, plan);
+	ReadyQueue wait = { NULL, 0, 0, 0 };
+	RunningSet running = { (Job**)malloc(sizeof(Job*) * cpus), 0 };
+	Job** onCpu = (Job**)calloc(cpus, sizeof(Job*));
+
+	simtime_t now = 0;
+	while (now < plan->duration) {
+		// First decision point: one or more tasks have been released
+		FireTimers(&wheel, now);
+		if (wheel.dueCount > 0) {
+			// Preempted jobs re-enter wait just ahead of the jobs released now
+			uint64_t preemptOrder = wait.order;
+			wait.order += cpus;
+
+			for (taskid_t due = 0; due < wheel.dueCount; ++due) {
+				Job* job = ReleaseJob(&wheel, plan, wheel.due[due], now);
+				job->cpu = NO_CPU;
+				ArmDeadline(&wheel, job);
+				job->order = wait.order++;
+				PushJob(&wait, job);
+			}
+			wheel.dueCount = 0;
+
+			// Only released jobs can have an earlier deadline than a running one, so this is the only place to preempt
+			while (running.count == cpus && wait.count > 0 && wait.jobs[0]->deadline < running.jobs[0]->deadline) {
+				Job* victim = running.jobs[0];
+				uint16_t cpu = victim->cpu;
+				RemoveRunning(&running, victim);
+				onCpu[cpu] = NULL;
+
+				// Make sure it didn't only just start on this CPU (not preemption)
+				if (GetActive(multi->lanes[cpu], now - 1) == victim->genericTask->columnIndex) {
+					SetStatus(multi->lanes[cpu], now - 1, victim->genericTask->taskIndex, STATUS_PREEMPTED);
+					++multi->preemptions[victim->genericTask->taskIndex];
+					COUNT(preemptions, 1);
+				}
+
+				victim->order = preemptOrder++;
+				PushJob(&wait, victim);
+				Dispatch(multi, &running, onCpu, cpu, PopJob(&wait));
+			}
+		}
+		FillCpus(multi, &wheel, &wait, &running, onCpu, now);
+
+		// The next decision point: a release or a running job's deadline (the next timer), or a running job finishing
+		uint64_t next = NextTimer(&wheel, UINT64_MAX);
+		if (next > plan->duration) {
+			next = plan->duration;
+		}
+		if (running.count == 0) {
+			now = (simtime_t)next;
+			continue;
+		}
+		for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+			Job* job = onCpu[cpu];
+			if (job != NULL && (uint64_t)now + job->runtime < next) {
+				next = now + job->runtime;
+			}
+		}
+
+		// Every CPU runs its job up to there, then the jobs which finished or are due leave their CPU
+		for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+			Job* job = onCpu[cpu];
+			if (job == NULL) {
+				continue;
+			}
+			SetActive(multi->lanes[cpu], now, (simtime_t)next, job->genericTask->columnIndex);
+			job->runtime -= (simtime_t)(next - now);
+		}
+		now = (simtime_t)next;
+		FireTimers(&wheel, now);
+		for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+			Job* job = onCpu[cpu];
+			if (job != NULL && (job->runtime == 0 || job->expired)) {
+				RemoveRunning(&running, job);
+				onCpu[cpu] = NULL;
+				CloseGlobalJob(multi, &wheel, job, now, multi->lanes[cpu]);
+			}
+		}
+		FillCpus(multi, &wheel, &wait, &running, onCpu, now);
+	}
+
+	// Cleanup any jobs that didn't finish
+	for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+		if (onCpu[cpu] != NULL) {
+			PushJob(&wait, onCpu[cpu]);
+		}
+	}
+	Job* job;
+	while ((job = PopJob(&wait)) != NULL) {
+		// Record the response time of aperiodic tasks
+		if (job->aperiodicTask != NULL) {
+			multi->aperiodicResponseTimes += plan->duration - job->release;
+		}
+		FreeJob(&jobPool, job);
+	}
+	COUNT(ticks, plan->duration);
+
+	free(wait.jobs);
+	free(running.jobs);
+	free(onCpu);
+	CleanWheel(&wheel);
+	for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+		FinishSchedule(multi->lanes[cpu]);
+	}
+	return multi;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Frees the calling thread's job pool kept between runs of EdfSimulation                                              |
+//---------------------------------------------------------------------------------------------------------------------+
+void CleanEdfSimulation(void) {
+	free(jobPool.slab);
+	jobPool.slab = NULL;
+	jobPool.capacity = jobPool.used = 0;
+	jobPool.freeList = NULL;
+}
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - processor demand bound of the periodic tasks over [0, t]: the work of every job due by t                   |
+// Deadlines are implicit (D = T), so a task has t / T jobs both released and due inside the interval                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static uint64_t Demand(SimPlan* plan, uint64_t t) {
+	uint64_t demand = 0;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		demand += t / plan->pTasks[pTask].T * plan->pTasks[pTask].C;
+	}
+	return demand;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - returns the latest absolute deadline strictly before t (0 => none), or the earliest after t when later     |
+//---------------------------------------------------------------------------------------------------------------------+
+static uint64_t AdjacentDeadline(SimPlan* plan, uint64_t t, bool later) {
+	uint64_t deadline = 0;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		uint64_t period = plan->pTasks[pTask].T;
+		if (later) {
+			uint64_t next = (t / period + 1) * period;
+			if (deadline == 0 || next < deadline) {
+				deadline = next;
+			}
+		}
+		else if (t > period) {
+			uint64_t prev = (t - 1) / period * period;
+			if (prev > deadline) {
+				deadline = prev;
+			}
+		}
+	}
+	return deadline;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Processor-demand (dbf) test of the periodic tasks under EDF, without simulating                                     |
+// Checks dbf(t) <= t at the deadlines inside the synchronous busy period using Quick convergence Processor-demand     |
+// Analysis, which walks down from the end of the busy period instead of up through every deadline                    |
+//---------------------------------------------------------------------------------------------------------------------+
+Analysis* EdfAnalysis(SimPlan* plan) {
+	Analysis* analysis = MakeAnalysis(plan);
+	analysis->fixedPriority = false;
+	analysis->busyPeriod = PlanBusyPeriod(plan);
+
+	uint64_t shortest = 0;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		if (plan->pTasks[pTask].T == 0) {
+			// A task which is due as it is released can never be met
+			analysis->schedulable = false;
+			return analysis;
+		}
+		if (shortest == 0 || plan->pTasks[pTask].T < shortest) {
+			shortest = plan->pTasks[pTask].T;
+		}
+	}
+
+	// Without a finite busy period the demand outgrows any interval, otherwise QPA settles the test
+	analysis->schedulable = plan->pCount == 0;
+	if (analysis->busyPeriod > 0) {
+		uint64_t t = AdjacentDeadline(plan, analysis->busyPeriod, false);
+		uint64_t demand = Demand(plan, t);
+		while (demand <= t && demand > shortest) {
+			t = demand < t ? demand : AdjacentDeadline(plan, t, false);
+			demand = Demand(plan, t);
+		}
+		analysis->schedulable = demand <= shortest;
+	}
+
+	// Any job finishes within the busy period it is released in, which bounds every response when all deadlines hold
+	if (analysis->schedulable) {
+		for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+			uint64_t period = plan->pTasks[pTask].T;
+			analysis->response[pTask] = analysis->busyPeriod < period ? analysis->busyPeriod : period;
+			analysis->meetsDeadline[pTask] = true;
+		}
+	}
+
+	// Otherwise find the first deadline the simulated horizon would miss (which task misses it depends on tie-breaking)
+	else {
+		for (uint64_t t = AdjacentDeadline(plan, 0, true); t < plan->duration; t = AdjacentDeadline(plan, t, true)) {
+			if (Demand(plan, t) > t) {
+				analysis->firstMiss = t;
+				break;
+			}
+		}
+	}
+
+	return analysis;
+}
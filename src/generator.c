@@ -0,0 +1,129 @@
+#include "parser.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - splitmix64: advances the state and returns the next 64 random bits                                         |
+// Small enough to keep one state per task set, so every set depends only on its seed and not on thread timing         |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline uint64_t NextRandom(uint64_t* state) {
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - uniform random number in [0, 1)                                                                            |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline double RandomUnit(uint64_t* state) {
+	return (NextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - uniform random integer in [min, max]                                                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline uint64_t RandomRange(uint64_t* state, uint64_t min, uint64_t max) {
+	return max <= min ? min : min + NextRandom(state) % (max - min + 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Fills in the generator's defaults: ten periodic tasks at 70% utilization over 10000 ticks, no aperiodic tasks       |
+//---------------------------------------------------------------------------------------------------------------------+
+void DefaultGenParams(GenParams* params) {
+	memset(params, 0, sizeof(GenParams));
+	params->pCount = 10;
+	params->aCount = 0;
+	params->utilization = 0.7;
+	params->duration = 10000;
+	params->minPeriod = 10;
+	params->maxPeriod = 1000;
+	params->aMinC = 1;
+	params->aMaxC = 50;
+	params->arrivals = ARRIVAL_POISSON;
+	params->burst = 4;
+	params->seed = 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Generates a random SimPlan in memory from the given parameters, the same seed always gives the same plan            |
+// Periodic utilizations are split with UUniFast and periods drawn log-uniformly, C = round(u * T) within [1, T]       |
+// Aperiodic releases follow the chosen arrival process over the horizon, their C uniform in [aMinC, aMaxC]            |
+//---------------------------------------------------------------------------------------------------------------------+
+SimPlan* GeneratePlan(const GenParams* params, uint64_t seed) {
+	uint64_t state = seed;
+
+	SimPlan* plan = (SimPlan*)calloc(sizeof(SimPlan), 1);
+	plan->duration = params->duration;
+	plan->pCount = params->pCount;
+	plan->aCount = params->aCount;
+	plan->tasks = plan->pCount + plan->aCount;
+	plan->pTasks = (PeriodicTask*)calloc(sizeof(PeriodicTask), plan->pCount + 1);
+	plan->aTasks = (AperiodicTask*)calloc(sizeof(AperiodicTask), plan->aCount + 1);
+
+	// Every ID is "P<n>" or "A<n>", 12 bytes always fits one with its terminator
+	plan->idArena = (char*)malloc(12 * ((size_t)plan->tasks + 1));
+	char* id = plan->idArena;
+
+	// UUniFast: peel each task's share off the remaining utilization so the shares are uniform over the simplex
+	double remaining = params->utilization;
+	double lnMin = log((double)params->minPeriod);
+	double lnMax = log((double)params->maxPeriod + 1.0);
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		double share = remaining;
+		if (pTask + 1 < plan->pCount) {
+			double next = remaining * pow(RandomUnit(&state), 1.0 / (plan->pCount - pTask - 1));
+			share = remaining - next;
+			remaining = next;
+		}
+
+		PeriodicTask* task = plan->pTasks + pTask;
+		task->T = (simtime_t)exp(lnMin + RandomUnit(&state) * (lnMax - lnMin));
+		if (task->T < params->minPeriod) {
+			task->T = params->minPeriod;
+		}
+		if (task->T > params->maxPeriod) {
+			task->T = params->maxPeriod;
+		}
+
+		double C = floor(share * task->T + 0.5);
+		task->C = C < 1.0 ? 1 : C > task->T ? task->T : (simtime_t)C;
+
+		task->taskIndex = pTask;
+		task->columnIndex = pTask + 1;
+		task->ID = id;
+		id += sprintf(id, "P%lu", (unsigned long)pTask) + 1;
+	}
+
+	// Aperiodic releases: independent uniform, a Poisson process, or Poisson bursts releasing several jobs at once
+	double mean = (double)params->duration / (plan->aCount + 1);
+	double arrival = 0.0;
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		AperiodicTask* task = plan->aTasks + aTask;
+
+		switch (params->arrivals) {
+			case ARRIVAL_UNIFORM:
+				arrival = RandomUnit(&state) * params->duration;
+				break;
+			case ARRIVAL_BURSTY:
+				if (params->burst == 0 || aTask % params->burst == 0) {
+					arrival += -log(1.0 - RandomUnit(&state)) * mean * (params->burst > 0 ? params->burst : 1);
+				}
+				break;
+			default:
+				arrival += -log(1.0 - RandomUnit(&state)) * mean;
+				break;
+		}
+		task->r = arrival < params->duration ? (simtime_t)arrival : params->duration - 1;
+		task->C = (simtime_t)RandomRange(&state, params->aMinC, params->aMaxC);
+
+		task->taskIndex = plan->pCount + aTask;
+		task->columnIndex = plan->pCount + aTask + 1;
+		task->ID = id;
+		id += sprintf(id, "A%lu", (unsigned long)aTask) + 1;
+	}
+
+	return plan;
+}
@@ -2,38 +2,187 @@
 #include "reporter.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-extern Schedule* RmSimulation(SimPlan* plan);
-extern Schedule* EdfSimulation(SimPlan* plan);
+extern void SimulatePlan(SimPlan* plan, FILE* fout, ScheduleSummary* rm, ScheduleSummary* edf, SimStats* stats);
+extern int RunBatch(const char* input, const char* outdir, SimSettings settings);
+extern int RunSweep(const char* fileout, GenParams params, double uMin, double uMax, double uStep, uint64_t sets,
+	SimSettings settings);
+extern void CleanEdfSimulation(void);
+extern bool WriteStatsBelow(SimPlan* plan, FILE* fout, SimStats* stats);
 
 int main(int argc, char** argv) {
-	const char* filein = argv[1];
-	const char* fileout = argv[2];
+	// Batch mode takes "--batch <plans> <outdir>" and sweep mode "--sweep <results>", shifting the file names by one
+	int batch = argc > 1 && strcmp(argv[1], "--batch") == 0;
+	int sweep = argc > 1 && strcmp(argv[1], "--sweep") == 0;
+	int files = batch || sweep ? 2 : 1;
+	int names = sweep ? 1 : 2;
+	if (argc < files + names) {
+		printf(
+			"Usage: lab2 <input> <output> [switches]\n"
+			"       lab2 --batch <plan dir|plan file> <outdir> [switches]\n"
+			"       lab2 --sweep <results.csv> [generator switches] [switches]\n");
+		return 1;
+	}
 
-	printf("The  input file: \"%s\"\nThe output file: \"%s\"\r\n", filein, fileout);
+	const char* filein = argv[files];
+	const char* fileout = argv[files + names - 1];
 
-	// Parse the input file
-	SimPlan* plan = ParsePlan(filein);
+	// Generated plans for sweeps, swept over utilization from uMin to uMax
+	GenParams params;
+	DefaultGenParams(&params);
+	double uMin = 0.5, uMax = 1.0, uStep = 0.05;
+	unsigned long long sets = 1000;
+
+	// Optional switches after the file names
+	SimSettings settings;
+	memset(&settings, 0, sizeof(SimSettings));
+	for (int arg = files + names; arg < argc; ++arg) {
+		if (strcmp(argv[arg], "--compact") == 0) {
+			settings.layout = LAYOUT_COMPACT;
+		}
+		else if (strcmp(argv[arg], "--hyperperiod") == 0) {
+			settings.extrapolate = 1;
+		}
+		else if (strcmp(argv[arg], "--analyze") == 0) {
+			settings.analysis = ANALYSIS_APPEND;
+		}
+		else if (strcmp(argv[arg], "--verdict") == 0) {
+			settings.analysis = ANALYSIS_ONLY;
+		}
+		else if (strcmp(argv[arg], "--quiet") == 0) {
+			settings.quiet = 1;
+		}
+		else if (strcmp(argv[arg], "--summary") == 0) {
+			settings.summaryOnly = 1;
+		}
+		else if (strcmp(argv[arg], "--counters") == 0 || strcmp(argv[arg], "--first-miss") == 0) {
+			// No timeline at all, so only the summary can be reported, optionally cut short at the first miss
+			settings.layout = LAYOUT_COUNTERS;
+			settings.summaryOnly = 1;
+			settings.stopAtMiss = settings.stopAtMiss || strcmp(argv[arg], "--first-miss") == 0;
+		}
+		else if (strcmp(argv[arg], "--format") == 0 && arg + 1 < argc) {
+			const char* format = argv[++arg];
+			settings.format =
+				strcmp(format, "binary") == 0 ? FORMAT_BINARY :
+				strcmp(format, "csv") == 0 ? FORMAT_CSV :
+				strcmp(format, "jsonl") == 0 ? FORMAT_JSONL : FORMAT_TABLE;
+		}
+		else if (strcmp(argv[arg], "--render-threads") == 0 && arg + 1 < argc) {
+			settings.renderThreads = (uint16_t)strtoul(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--stats") == 0) {
+			settings.stats = 1;
+		}
+		else if (strcmp(argv[arg], "--cores") == 0 && arg + 1 < argc) {
+			settings.cores = (uint16_t)strtoul(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--global") == 0) {
+			settings.global = 1;
+		}
+		else if (strcmp(argv[arg], "--asap") == 0 && arg + 1 < argc) {
+			// "rm" or "dm" priorities for the forward fixed priority schedule reported after ALAP RM
+			settings.asap = strcmp(argv[++arg], "dm") == 0 ? ASAP_DEADLINE_MONOTONIC : ASAP_RATE_MONOTONIC;
+		}
+		else if (strcmp(argv[arg], "--packing") == 0 && arg + 1 < argc) {
+			// "first", "best" or "worst" fit, each in decreasing utilization order
+			const char* packing = argv[++arg];
+			settings.packing =
+				strcmp(packing, "best") == 0 ? PACKING_BEST_FIT :
+				strcmp(packing, "worst") == 0 ? PACKING_WORST_FIT : PACKING_FIRST_FIT;
+		}
+
+		// Generator switches (only used by sweeps)
+		else if (strcmp(argv[arg], "--tasks") == 0 && arg + 1 < argc) {
+			params.pCount = (taskid_t)strtoul(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--aperiodic") == 0 && arg + 1 < argc) {
+			params.aCount = (taskid_t)strtoul(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--horizon") == 0 && arg + 1 < argc) {
+			params.duration = (simtime_t)strtoull(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--utilization") == 0 && arg + 1 < argc) {
+			// "min[:max[:step]]", a single value sweeps just that one utilization
+			int got = sscanf(argv[++arg], "%lf:%lf:%lf", &uMin, &uMax, &uStep);
+			if (got == 1) {
+				uMax = uMin;
+			}
+		}
+		else if (strcmp(argv[arg], "--periods") == 0 && arg + 1 < argc) {
+			unsigned long long minPeriod = params.minPeriod, maxPeriod = params.maxPeriod;
+			sscanf(argv[++arg], "%llu:%llu", &minPeriod, &maxPeriod);
+			params.minPeriod = (simtime_t)minPeriod;
+			params.maxPeriod = (simtime_t)maxPeriod;
+		}
+		else if (strcmp(argv[arg], "--aperiodic-c") == 0 && arg + 1 < argc) {
+			unsigned long long aMinC = params.aMinC, aMaxC = params.aMaxC;
+			sscanf(argv[++arg], "%llu:%llu", &aMinC, &aMaxC);
+			params.aMinC = (simtime_t)aMinC;
+			params.aMaxC = (simtime_t)aMaxC;
+		}
+		else if (strcmp(argv[arg], "--arrivals") == 0 && arg + 1 < argc) {
+			// "poisson", "uniform" or "bursty[:releases per burst]"
+			const char* arrivals = argv[++arg];
+			params.arrivals =
+				strcmp(arrivals, "uniform") == 0 ? ARRIVAL_UNIFORM :
+				strncmp(arrivals, "bursty", 6) == 0 ? ARRIVAL_BURSTY : ARRIVAL_POISSON;
+			if (params.arrivals == ARRIVAL_BURSTY && arrivals[6] == ':') {
+				params.burst = (taskid_t)strtoul(arrivals + 7, NULL, 10);
+			}
+		}
+		else if (strcmp(argv[arg], "--sets") == 0 && arg + 1 < argc) {
+			sets = strtoull(argv[++arg], NULL, 10);
+		}
+		else if (strcmp(argv[arg], "--seed") == 0 && arg + 1 < argc) {
+			params.seed = strtoull(argv[++arg], NULL, 10);
+		}
+	}
+
+	if (sweep) {
+		// A sweep judges thousands of generated plans and reports only their acceptance ratios
+		if (settings.stats) {
+			fprintf(stderr, "--stats is ignored with --sweep\n");
+		}
+		printf("The output file: \"%s\"\r\n", fileout);
+		return RunSweep(fileout, params, uMin, uMax, uStep, sets, settings);
+	}
 
-	// Run the SimPlan
-	Schedule* rmsched = RmSimulation(plan);
-	Schedule* edfsched = EdfSimulation(plan);
+	if (batch) {
+		printf("The  input plans: \"%s\"\nThe output folder: \"%s\"\r\n", filein, fileout);
+		return RunBatch(filein, fileout, settings);
+	}
 
-	// Output the results
-	FILE* fout = fopen(fileout, "w");
+	printf("The  input file: \"%s\"\nThe output file: \"%s\"\r\n", filein, fileout);
+
+	// Phase timers and engine counters, only collected with --stats
+	SimStats stats;
+	memset(&stats, 0, sizeof(SimStats));
+
+	// Parse the input file
+	StartPhase(&stats.parse);
+	SimPlan* plan = ParsePlan(filein, settings.quiet);
+	StopPhase(&stats.parse);
+	if (plan == NULL) {
+		return 1;
+	}
+	plan->settings = settings;
 
-	fprintf(fout, "--------------- ALAP Rate Monotonic ---------------\r\n");
-	WriteSchedule(fout, rmsched);
-	fprintf(fout, "\r\n");
+	// Run the SimPlan and output the results
+	// Opened for reading too so the table can be memory-mapped
+	FILE* fout = fopen(fileout, "w+");
+	SimulatePlan(plan, fout, NULL, NULL, settings.stats ? &stats : NULL);
 
-	fprintf(fout, "------------- Earliest Deadline First -------------\r\n");
-	WriteSchedule(fout, edfsched);
+	// The statistics go below the summaries of a table or JSON lines, a binary or CSV trace keeps its shape
+	if (settings.stats && !WriteStatsBelow(plan, fout, &stats)) {
+		WriteStats(stdout, &stats);
+	}
 	fclose(fout);
 
 	// Cleanup
-	CleanSchedule(rmsched);
-	CleanSchedule(edfsched);
 	CleanPlan(plan);
+	CleanEdfSimulation();
 
 	return 0;
 }
@@ -1,129 +1,736 @@
 #include "parser.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Largest values the narrow or wide typedefs can hold
+#define SIMTIME_MAX ((simtime_t)~(simtime_t)0)
+#define TASKID_MAX ((taskid_t)~(taskid_t)0)
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - reports malformed input at the reader's current line and marks the reader as failed                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static void ParseError(PlanReader* reader, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "%s:%lu: ", reader->file, (unsigned long)reader->line);
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+	reader->failed = true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - reports questionable input at the reader's current line, the plan is still used                           |
+//---------------------------------------------------------------------------------------------------------------------+
+static void ParseWarning(PlanReader* reader, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "%s:%lu: warning: ", reader->file, (unsigned long)reader->line);
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - moves to the next line which isn't blank and returns its bounds in the input, false at the end of input    |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool NextLine(PlanReader* reader, const char** line, const char** eol) {
+	while (reader->pos < reader->size) {
+		const char* start = reader->data + reader->pos;
+		const char* end = memchr(start, '\n', reader->size - reader->pos);
+		if (end == NULL) {
+			end = reader->data + reader->size;
+		}
+		reader->pos = (size_t)(end - reader->data) + 1;
+		++(reader->line);
+
+		// Trim the line ending and surrounding whitespace
+		while (start < end && (*start == ' ' || *start == '\t')) { ++start; }
+		while (end > start && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) { --end; }
+		if (start < end) {
+			*line = start;
+			*eol = end;
+			return true;
+		}
+	}
+	return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - parses an unsigned number no greater than max from [*text, eol), skipping spaces around it                 |
+// Leaves *text just past it, or reports what was expected (by name) and returns false                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool ParseNumber(PlanReader* reader, const char** text, const char* eol, uint64_t max, const char* name,
+	uint64_t* value) {
+	const char* cur = *text;
+	while (cur < eol && *cur == ' ') { ++cur; }
+
+	if (cur == eol || *cur < '0' || *cur > '9') {
+		ParseError(reader, "expected %s, found \"%.*s\"", name, (int)(eol - cur), cur);
+		return false;
+	}
+
+	uint64_t n = 0;
+	for (; cur < eol && *cur >= '0' && *cur <= '9'; ++cur) {
+		uint64_t digit = *cur - '0';
+		if (n > (max - digit) / 10) {
+			ParseError(reader, "%s is larger than %llu%s", name, (unsigned long long)max,
+#ifdef WIDE_INTEGERS
+				"");
+#else
+				" (build with make WIDE=1 for larger values)");
+#endif
+			return false;
+		}
+		n = n * 10 + digit;
+	}
+
+	while (cur < eol && *cur == ' ') { ++cur; }
+	*text = cur;
+	*value = n;
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - parses a line which holds nothing but one number                                                           |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool ParseCountLine(PlanReader* reader, const char* line, const char* eol, uint64_t max, const char* name,
+	uint64_t* value) {
+	if (!ParseNumber(reader, &line, eol, max, name, value)) {
+		return false;
+	}
+	if (line != eol) {
+		ParseError(reader, "unexpected \"%.*s\" after the %s", (int)(eol - line), line, name);
+		return false;
+	}
+	return true;
+}
 
 //---------------------------------------------------------------------------------------------------------------------+
 // Helper which decreases code duplication in the parsing of periodic and aperiodic tasks from the input file          |
 // Exploits the symmetry of struct PeriodicTask and struct AperiodicTask                                               |
 // Exploits the symmetry of the input file format "ID, C, T/r" for Periodic/Aperiodic                                  |
+// The ID is copied into the arena, its offset is returned through idOffset since the arena may still move             |
 //---------------------------------------------------------------------------------------------------------------------+
-static inline void ParseTask(char* buff, size_t line_n, PeriodicTask* task) {
-	// Indicies of string parsing bounds
-	size_t
-		bos = 0, // beginning of string
-		eos = 0; // end of string
-
+static bool ParseTask(PlanReader* reader, const char* line, const char* eol, PeriodicTask* task, const char* last,
+	char** arena, size_t* arenaUsed, size_t* arenaCapacity, size_t* idOffset) {
 	// Get the ID
-	{
-		while (eos < line_n && buff[eos] != ',') { ++eos; }
-		// A fully rigorous program would probably do some validation here
+	const char* comma = memchr(line, ',', eol - line);
+	const char* idEnd = comma != NULL ? comma : eol;
+	while (idEnd > line && idEnd[-1] == ' ') { --idEnd; }
+	if (comma == NULL || idEnd == line) {
+		ParseError(reader, "expected \"ID, C, %s\", found \"%.*s\"", last, (int)(eol - line), line);
+		return false;
+	}
 
-		task->ID = (char*)malloc(eos + 1);
-		memcpy(task->ID, buff, eos);
-		task->ID[eos] = 0;
+	size_t len = (size_t)(idEnd - line);
+	if (*arenaUsed + len + 1 > *arenaCapacity) {
+		while (*arenaUsed + len + 1 > *arenaCapacity) {
+			*arenaCapacity = *arenaCapacity == 0 ? 256 : *arenaCapacity * 2;
+		}
+		*arena = (char*)realloc(*arena, *arenaCapacity);
 	}
+	*idOffset = *arenaUsed;
+	memcpy(*arena + *arenaUsed, line, len);
+	(*arena)[*arenaUsed + len] = 0;
+	*arenaUsed += len + 1;
 
 	// Get the execution time
-	{
-		bos = ++eos; // buff + eos => ", ", buff + (++eos) => " "
-		while (eos < line_n && buff[eos] == ' ') { ++eos; ++bos; } // Get rid of space
-		while (eos < line_n && buff[eos] != ',') { ++eos; }
-		// A fully rigorous program would probably do some validation here
-
-		buff[eos] = 0; // replace comma with a null pointer to aid the atoi function
-		task->C = atoi(buff + bos);
+	uint64_t value;
+	const char* cur = comma + 1;
+	if (!ParseNumber(reader, &cur, eol, SIMTIME_MAX, "C", &value)) {
+		return false;
+	}
+	task->C = (simtime_t)value;
+	if (cur == eol || *cur != ',') {
+		ParseError(reader, "expected \", %s\" after C", last);
+		return false;
 	}
 
 	// Get the period (for periodic) or the absolute release time (for aperiodic)
-	{
-		bos = ++eos; // buff + eos => "\0 ", buff + (++eos) => " "
-		while (eos < line_n && buff[eos] == ' ') { ++eos; ++bos; } // Get rid of space
-		while (eos < line_n && buff[eos] != ',') { ++eos; }
-		// A fully rigorous program would probably do some validation here
+	++cur;
+	if (!ParseNumber(reader, &cur, eol, SIMTIME_MAX, last, &value)) {
+		return false;
+	}
+	task->T = (simtime_t)value; // same memory location and size for (AperiodicTask*)->r
+	if (cur != eol) {
+		ParseError(reader, "unexpected \"%.*s\" after %s", (int)(eol - cur), cur, last);
+		return false;
+	}
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - parses a plan's server line "server, kind, Qs, Ts" into the given server                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool ParseServer(PlanReader* reader, const char* line, const char* eol, AperiodicServer* server) {
+	const char* kind = memchr(line, ',', eol - line);
+	const char* kindEnd = kind != NULL ? memchr(kind + 1, ',', eol - kind - 1) : NULL;
+	if (kindEnd == NULL) {
+		ParseError(reader, "expected \"server, kind, Qs, Ts\", found \"%.*s\"", (int)(eol - line), line);
+		return false;
+	}
+	for (++kind; kind < kindEnd && *kind == ' '; ++kind) {}
+	size_t len = (size_t)(kindEnd - kind);
+	while (len > 0 && kind[len - 1] == ' ') { --len; }
+
+	server->kind = SERVER_NONE;
+	for (uint8_t candidate = SERVER_POLLING; candidate <= SERVER_CONSTANT_BANDWIDTH; ++candidate) {
+		const char* name = ServerName(candidate);
+		if (strlen(name) == len && strncasecmp(kind, name, len) == 0) {
+			server->kind = candidate;
+		}
+	}
+	if (server->kind == SERVER_NONE) {
+		ParseError(reader, "unknown server \"%.*s\" (expected polling, deferrable, sporadic, tbs or cbs)", (int)len, kind);
+		return false;
+	}
 
-		buff[eos] = 0; // replace comma with a null pointer to aid the atoi function
-		task->T = atoi(buff + bos); // same memory location and size for (AperiodicTask*)->r
+	uint64_t value;
+	const char* cur = kindEnd + 1;
+	if (!ParseNumber(reader, &cur, eol, SIMTIME_MAX, "Qs", &value)) {
+		return false;
 	}
+	server->budget = (simtime_t)value;
+	if (cur == eol || *cur != ',') {
+		ParseError(reader, "expected \", Ts\" after Qs");
+		return false;
+	}
+	++cur;
+	if (!ParseNumber(reader, &cur, eol, SIMTIME_MAX, "Ts", &value)) {
+		return false;
+	}
+	server->period = (simtime_t)value;
+	if (cur != eol) {
+		ParseError(reader, "unexpected \"%.*s\" after Ts", (int)(eol - cur), cur);
+		return false;
+	}
+	if (server->budget == 0 || server->budget > server->period) {
+		ParseError(reader, "a server needs 0 < Qs <= Ts");
+		return false;
+	}
+	return true;
 }
 
 //---------------------------------------------------------------------------------------------------------------------+
-// Returns a SimPlan struct with the relevant task settings based on data parsed from the given input file             |
+// Helper - warns when the plan's server and periodic tasks can't be guaranteed together                               |
+// TBS and CBS need U + Qs / Ts <= 1 under EDF, the RM servers need the utilization bound or else the exact           |
+// response-time test with the server as one more task at its level (below the periodic tasks with T <= Ts)            |
 //---------------------------------------------------------------------------------------------------------------------+
-SimPlan* ParsePlan(const char* file) {
-	SimPlan* plan = (SimPlan*)calloc(sizeof(SimPlan), 1);
-	FILE* fin = fopen(file, "r");
+static void CheckServer(PlanReader* reader, SimPlan* plan) {
+	AperiodicServer* server = &plan->server;
+	double utilization = 0.0;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		utilization += (double)plan->pTasks[pTask].C / plan->pTasks[pTask].T;
+	}
+	double share = (double)server->budget / server->period;
+
+	if (server->kind == SERVER_TOTAL_BANDWIDTH || server->kind == SERVER_CONSTANT_BANDWIDTH) {
+		if (utilization + share > 1.0 + 1e-9) {
+			ParseWarning(reader, "periodic utilization %.4f plus the %s server's %.4f exceeds 1, EDF can't guarantee "
+				"the deadlines", utilization, ServerName(server->kind), share);
+		}
+		return;
+	}
+	if (plan->pCount == 0) {
+		return;
+	}
+
+	// Liu and Layland's bound counting the server as a task, or Lehoczky's for the deferrable server's back to back runs
+	double n = plan->pCount;
+	bool bounded = server->kind == SERVER_DEFERRABLE ?
+		utilization <= n * (pow((share + 2.0) / (2.0 * share + 1.0), 1.0 / n) - 1.0) :
+		utilization + share <= (n + 1.0) * (pow(2.0, 1.0 / (n + 1.0)) - 1.0);
+	if (bounded) {
+		return;
+	}
+
+	// The deferrable server can run at the end of one period and again at the start of the next, a jitter of Ts - Qs
+	uint64_t jitter = server->kind == SERVER_DEFERRABLE ? server->period - server->budget : 0;
+	for (taskid_t level = 0; level <= plan->pCount; ++level) {
+		bool isServer = level == plan->pCount;
+		uint64_t C = isServer ? server->budget : plan->pTasks[level].C;
+		uint64_t T = isServer ? server->period : plan->pTasks[level].T;
 
-	size_t buffsize = 128;
-	char* buff = (char*)calloc(sizeof(char), buffsize);
+		// Same iteration as RmAnalysis, with the priorities of the forward RM engine
+		uint64_t response = C, next = 0;
+		while (response <= T && response != next) {
+			next = response;
+			response = C;
+			for (taskid_t hp = 0; hp < plan->pCount; ++hp) {
+				PeriodicTask* other = plan->pTasks + hp;
+				bool higher = isServer ? other->T <= T :
+					other->T < T || (other->T == T && (other->C > C || (other->C == C && hp < level)));
+				if (higher) {
+					response += (next + other->T - 1) / other->T * other->C;
+				}
+			}
+			if (!isServer && server->period < T) {
+				response += (next + jitter + server->period - 1) / server->period * server->budget;
+			}
+		}
 
-	size_t line_n; // the length of each line (including 2 for \r\n)
+		if (response > T) {
+			if (isServer) {
+				ParseWarning(reader, "the %s server fails the RM bound and can't use its Qs within every Ts",
+					ServerName(server->kind));
+			}
+			else {
+				ParseWarning(reader, "the %s server fails the RM bound and task \"%s\" fails the response-time test with it",
+					ServerName(server->kind), plan->pTasks[level].ID);
+			}
+			return;
+		}
+	}
+}
 
-	{
-		// Parse the file to get pCount
-		fgets(buff, buffsize, fin);
-		plan->pCount = atoi(buff);
+//---------------------------------------------------------------------------------------------------------------------+
+// Opens a plan file for reading: mapped into memory when possible, otherwise (e.g. a pipe) read into memory           |
+// Returns NULL (after reporting why) if the file cannot be read                                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+PlanReader* OpenPlans(const char* file, bool quiet) {
+	int fd = open(file, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Unable to read \"%s\": %s\n", file, strerror(errno));
+		return NULL;
+	}
 
-		// Parse the file to get time
-		fgets(buff, buffsize, fin);
-		plan->duration = atoi(buff);
+	PlanReader* reader = (PlanReader*)calloc(1, sizeof(PlanReader));
+	reader->file = file;
+	reader->quiet = quiet;
 
-		if (plan->pCount > 0) {
-			plan->pTasks = (PeriodicTask*)calloc(sizeof(PeriodicTask), plan->pCount);
+	struct stat info;
+	if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+		void* map = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			reader->data = (const char*)map;
+			reader->size = (size_t)info.st_size;
+			reader->mapped = true;
 		}
 	}
-	printf("Time: %i\npCount: %i\n", plan->duration, plan->pCount);
+
+	if (!reader->mapped) {
+		size_t capacity = 0;
+		char* data = NULL;
+		ssize_t got;
+		do {
+			if (reader->size == capacity) {
+				capacity = capacity == 0 ? 65536 : capacity * 2;
+				data = (char*)realloc(data, capacity);
+			}
+			got = read(fd, data + reader->size, capacity - reader->size);
+			if (got > 0) {
+				reader->size += (size_t)got;
+			}
+		} while (got > 0);
+		reader->data = data;
+	}
+
+	close(fd);
+	return reader;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Unmaps (or frees) the input, plans already read stay valid                                                          |
+//---------------------------------------------------------------------------------------------------------------------+
+void ClosePlans(PlanReader* reader) {
+	if (reader->mapped) {
+		munmap((void*)reader->data, reader->size);
+	}
+	else {
+		free((void*)reader->data);
+	}
+	free(reader);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Reads the next plan from the input, tokenizing it in place with the task IDs interned into the plan's arena         |
+// Returns NULL once there are no plans left, or on malformed input (reported by line, reader->failed is then set)     |
+// Blank lines are skipped, so plans may be stacked in one file (each must then give its aCount line)                  |
+//---------------------------------------------------------------------------------------------------------------------+
+SimPlan* NextPlan(PlanReader* reader) {
+	const char *line, *eol;
+	uint64_t value;
+
+	// Find the first line of the plan
+	if (reader->failed || !NextLine(reader, &line, &eol)) {
+		return NULL;
+	}
+
+	SimPlan* plan = (SimPlan*)calloc(sizeof(SimPlan), 1);
+	char* arena = NULL;
+	size_t arenaUsed = 0, arenaCapacity = 0;
+	size_t* idOffsets = NULL;
+
+	// Parse the file to get pCount
+	if (!ParseCountLine(reader, line, eol, TASKID_MAX, "pCount", &value)) {
+		goto fail;
+	}
+	plan->pCount = (taskid_t)value;
+
+	// Parse the file to get time
+	if (!NextLine(reader, &line, &eol)) {
+		ParseError(reader, "unexpected end of input, expected the duration");
+		goto fail;
+	}
+	if (!ParseCountLine(reader, line, eol, SIMTIME_MAX, "duration", &value)) {
+		goto fail;
+	}
+	plan->duration = (simtime_t)value;
+
+	if (!reader->quiet) {
+		printf("Time: %llu\npCount: %lu\n", (unsigned long long)plan->duration, (unsigned long)plan->pCount);
+	}
+
+	plan->pTasks = (PeriodicTask*)calloc(sizeof(PeriodicTask), plan->pCount + 1);
+	idOffsets = (size_t*)malloc(sizeof(size_t) * ((size_t)plan->pCount + 1));
 
 	// Parse the file pCount times to get the data for each periodic task
-	for (uint8_t pTask = 0; pTask < plan->pCount; ++pTask) {
-		line_n = getline(&buff, &buffsize, fin);
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		if (!NextLine(reader, &line, &eol)) {
+			ParseError(reader, "unexpected end of input, expected %lu more periodic tasks",
+				(unsigned long)(plan->pCount - pTask));
+			goto fail;
+		}
 		PeriodicTask* task = (plan->pTasks) + pTask;
-		ParseTask(buff, line_n, task);
+		if (!ParseTask(reader, line, eol, task, "T", &arena, &arenaUsed, &arenaCapacity, idOffsets + pTask)) {
+			goto fail;
+		}
+		if (task->T == 0) {
+			ParseError(reader, "the period T must be positive");
+			goto fail;
+		}
 		task->taskIndex = pTask;
 		task->columnIndex = pTask + 1;
-		printf("pTasks[%i]: {ID: \"%s\", C: %i, T: %i}\n", pTask, task->ID, task->C, task->T);
 	}
 
 	// Parse the file to get aCount (optional parameter)
-	char* optional = fgets(buff, buffsize, fin);
-	if (optional != NULL) {
-		plan->aCount = atoi(buff);
-		if (plan->aCount > 0) {
-			plan->aTasks = (AperiodicTask*)calloc(sizeof(AperiodicTask), plan->aCount);
+	if (NextLine(reader, &line, &eol)) {
+		if (!ParseCountLine(reader, line, eol, TASKID_MAX - plan->pCount, "aCount", &value)) {
+			goto fail;
 		}
+		plan->aCount = (taskid_t)value;
 	}
-	printf("aCount: %i\n", plan->aCount);
 
-	// Parse the file aCount times to get the data for each periodic task
-	for (uint8_t aTask = 0; aTask < plan->aCount; ++aTask) {
-		line_n = getline(&buff, &buffsize, fin);
+	plan->aTasks = (AperiodicTask*)calloc(sizeof(AperiodicTask), plan->aCount + 1);
+	idOffsets = (size_t*)realloc(idOffsets, sizeof(size_t) * ((size_t)plan->pCount + plan->aCount + 1));
+
+	// Parse the file aCount times to get the data for each aperiodic task
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		if (!NextLine(reader, &line, &eol)) {
+			ParseError(reader, "unexpected end of input, expected %lu more aperiodic tasks",
+				(unsigned long)(plan->aCount - aTask));
+			goto fail;
+		}
 		AperiodicTask* task = (plan->aTasks) + aTask;
-		ParseTask(buff, line_n, (PeriodicTask*)task);
+		if (!ParseTask(reader, line, eol, (PeriodicTask*)task, "r", &arena, &arenaUsed, &arenaCapacity,
+			idOffsets + plan->pCount + aTask)) {
+			goto fail;
+		}
+		if (task->r >= plan->duration) {
+			ParseError(reader, "the release r must be below the duration");
+			goto fail;
+		}
 		task->taskIndex = plan->pCount + aTask;
 		task->columnIndex = plan->pCount + aTask + 1;
-		printf("aTasks[%i]: {ID: \"%s\", C: %i, r: %i}\n", aTask, task->ID, task->C, task->r);
+	}
+
+	// Parse the server line (optional), anything else is left for the next plan
+	size_t pos = reader->pos, lineNumber = reader->line;
+	if (NextLine(reader, &line, &eol)) {
+		if (eol - line >= 6 && strncasecmp(line, "server", 6) == 0) {
+			if (!ParseServer(reader, line, eol, &plan->server)) {
+				goto fail;
+			}
+		}
+		else {
+			reader->pos = pos;
+			reader->line = lineNumber;
+		}
 	}
 
 	// A total count is worth summing now rather than later
 	plan->tasks = plan->pCount + plan->aCount;
 
-	fclose(fin);
+	// The arena is done moving, so the IDs can point into it
+	plan->idArena = arena;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		plan->pTasks[pTask].ID = arena + idOffsets[pTask];
+	}
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		plan->aTasks[aTask].ID = arena + idOffsets[plan->pCount + aTask];
+	}
+	free(idOffsets);
+
+	if (plan->server.kind != SERVER_NONE) {
+		CheckServer(reader, plan);
+	}
+
+	if (!reader->quiet) {
+		for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+			PeriodicTask* task = plan->pTasks + pTask;
+			printf("pTasks[%lu]: {ID: \"%s\", C: %llu, T: %llu}\n",
+				(unsigned long)pTask, task->ID, (unsigned long long)task->C, (unsigned long long)task->T);
+		}
+		printf("aCount: %lu\n", (unsigned long)plan->aCount);
+		for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+			AperiodicTask* task = plan->aTasks + aTask;
+			printf("aTasks[%lu]: {ID: \"%s\", C: %llu, r: %llu}\n",
+				(unsigned long)aTask, task->ID, (unsigned long long)task->C, (unsigned long long)task->r);
+		}
+		if (plan->server.kind != SERVER_NONE) {
+			printf("server: {kind: %s, Qs: %llu, Ts: %llu}\n", ServerName(plan->server.kind),
+				(unsigned long long)plan->server.budget, (unsigned long long)plan->server.period);
+		}
+	}
+
 	return plan;
+
+fail:
+	free(arena);
+	free(idOffsets);
+	free(plan->pTasks);
+	free(plan->aTasks);
+	free(plan);
+	return NULL;
 }
 
-void CleanPlan(SimPlan* plan) {
-	// Cleanup pTasks
-	for (uint8_t pTask = 0; pTask < plan->pCount; ++pTask) {
-		free(plan->pTasks[pTask].ID);
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns a SimPlan struct with the relevant task settings based on data parsed from the given input file             |
+// Returns NULL (after reporting why) if the file cannot be read or is malformed                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+SimPlan* ParsePlan(const char* file, bool quiet) {
+	PlanReader* reader = OpenPlans(file, quiet);
+	if (reader == NULL) {
+		return NULL;
 	}
-	free(plan->pTasks);
 
-	// Cleanup aTasks
-	for (uint8_t aTask = 0; aTask < plan->aCount; ++aTask) {
-		free(plan->aTasks[aTask].ID);
+	SimPlan* plan = NextPlan(reader);
+	if (plan == NULL && !reader->failed) {
+		fprintf(stderr, "%s: no plan found\n", file);
 	}
-	free(plan->aTasks);
 
-	// Cleanup plan
+	ClosePlans(reader);
+	return plan;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes the given plan in the input file format, so ParsePlan reads it back as the same plan                         |
+//---------------------------------------------------------------------------------------------------------------------+
+void WritePlan(FILE* fout, SimPlan* plan) {
+	fprintf(fout, "%lu\n%llu\n", (unsigned long)plan->pCount, (unsigned long long)plan->duration);
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		PeriodicTask* task = plan->pTasks + pTask;
+		fprintf(fout, "%s, %llu, %llu\n", task->ID, (unsigned long long)task->C, (unsigned long long)task->T);
+	}
+	fprintf(fout, "%lu\n", (unsigned long)plan->aCount);
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		AperiodicTask* task = plan->aTasks + aTask;
+		fprintf(fout, "%s, %llu, %llu\n", task->ID, (unsigned long long)task->C, (unsigned long long)task->r);
+	}
+	if (plan->server.kind != SERVER_NONE) {
+		fprintf(fout, "server, %s, %llu, %llu\n", ServerName(plan->server.kind),
+			(unsigned long long)plan->server.budget, (unsigned long long)plan->server.period);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Appropriately frees the memory associated with the given plan                                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+void CleanPlan(SimPlan* plan) {
+	free(plan->idArena);
+	free(plan->pTasks);
+	free(plan->aTasks);
 	free(plan);
 }
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns a copy of the given plan with the edit made to it, leaving the given plan as it was                         |
+// Returns NULL if the edit doesn't fit the plan (no such task, a zero period, a release past the duration...)         |
+//---------------------------------------------------------------------------------------------------------------------+
+SimPlan* EditPlan(SimPlan* plan, PlanEdit* edit) {
+	switch (edit->kind) {
+		case EDIT_PERIODIC:
+			if (edit->index >= plan->pCount || edit->time == 0) {
+				return NULL;
+			}
+			break;
+		case EDIT_APERIODIC:
+			if (edit->index >= plan->aCount || edit->time >= plan->duration) {
+				return NULL;
+			}
+			break;
+		case EDIT_ADD_APERIODIC:
+			if (plan->tasks == TASKID_MAX || edit->ID == NULL || edit->time >= plan->duration) {
+				return NULL;
+			}
+			break;
+		default:
+			return NULL;
+	}
+
+	SimPlan* copy = (SimPlan*)malloc(sizeof(SimPlan));
+	*copy = *plan;
+	if (edit->kind == EDIT_ADD_APERIODIC) {
+		++copy->aCount;
+		++copy->tasks;
+	}
+
+	copy->pTasks = (PeriodicTask*)calloc(sizeof(PeriodicTask), copy->pCount + 1);
+	memcpy(copy->pTasks, plan->pTasks, sizeof(PeriodicTask) * plan->pCount);
+	copy->aTasks = (AperiodicTask*)calloc(sizeof(AperiodicTask), copy->aCount + 1);
+	memcpy(copy->aTasks, plan->aTasks, sizeof(AperiodicTask) * plan->aCount);
+
+	switch (edit->kind) {
+		case EDIT_PERIODIC:
+			copy->pTasks[edit->index].C = edit->C;
+			copy->pTasks[edit->index].T = edit->time;
+			break;
+		case EDIT_APERIODIC:
+			copy->aTasks[edit->index].C = edit->C;
+			copy->aTasks[edit->index].r = edit->time;
+			break;
+		case EDIT_ADD_APERIODIC: {
+			AperiodicTask* task = copy->aTasks + plan->aCount;
+			task->taskIndex = plan->tasks;
+			task->columnIndex = plan->tasks + 1;
+			task->ID = (char*)edit->ID;
+			task->C = edit->C;
+			task->r = edit->time;
+			break;
+		}
+	}
+
+	// Intern the IDs again so the copy owns all of them
+	size_t arenaSize = 0;
+	for (taskid_t pTask = 0; pTask < copy->pCount; ++pTask) {
+		arenaSize += strlen(copy->pTasks[pTask].ID) + 1;
+	}
+	for (taskid_t aTask = 0; aTask < copy->aCount; ++aTask) {
+		arenaSize += strlen(copy->aTasks[aTask].ID) + 1;
+	}
+	copy->idArena = (char*)malloc(arenaSize + 1);
+	char* id = copy->idArena;
+	for (taskid_t pTask = 0; pTask < copy->pCount; ++pTask) {
+		size_t length = strlen(copy->pTasks[pTask].ID) + 1;
+		copy->pTasks[pTask].ID = (char*)memcpy(id, copy->pTasks[pTask].ID, length);
+		id += length;
+	}
+	for (taskid_t aTask = 0; aTask < copy->aCount; ++aTask) {
+		size_t length = strlen(copy->aTasks[aTask].ID) + 1;
+		copy->aTasks[aTask].ID = (char*)memcpy(id, copy->aTasks[aTask].ID, length);
+		id += length;
+	}
+
+	return copy;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns the earliest tick the given edit can change in a simulation of the plan it is made to                       |
+// Every periodic task releases at 0, while an aperiodic task makes no difference until it is released                 |
+//---------------------------------------------------------------------------------------------------------------------+
+simtime_t FirstEditedTick(SimPlan* plan, PlanEdit* edit) {
+	switch (edit->kind) {
+		case EDIT_APERIODIC: {
+			simtime_t r = plan->aTasks[edit->index].r;
+			return edit->time < r ? edit->time : r;
+		}
+		case EDIT_ADD_APERIODIC:
+			return edit->time;
+		default:
+			return 0;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns the hyperperiod (least common multiple of all periods) of the periodic tasks in the given plan              |
+// Returns 0 when there are no periodic tasks or the hyperperiod does not fit within the plan's duration               |
+//---------------------------------------------------------------------------------------------------------------------+
+simtime_t PlanHyperperiod(SimPlan* plan) {
+	uint64_t hyperperiod = 1;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		uint64_t a = hyperperiod, b = plan->pTasks[pTask].T;
+		if (b == 0) {
+			return 0;
+		}
+
+		// Euclid's algorithm for the greatest common divisor
+		while (b != 0) {
+			uint64_t temp = a % b;
+			a = b;
+			b = temp;
+		}
+
+		// Check against the duration before multiplying so the product can't overflow
+		uint64_t factor = hyperperiod / a;
+		if (factor > plan->duration / plan->pTasks[pTask].T) {
+			return 0;
+		}
+		hyperperiod = factor * plan->pTasks[pTask].T;
+	}
+	return plan->pCount > 0 ? (simtime_t)hyperperiod : 0;
+}
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns the length of the synchronous busy period of the periodic tasks (all released together at time 0)           |
+// Returns 0 when there are no periodic tasks or their utilization exceeds 1, so the busy period never ends            |
+//---------------------------------------------------------------------------------------------------------------------+
+uint64_t PlanBusyPeriod(SimPlan* plan) {
+	double utilization = 0.0;
+	uint64_t busy = 0, next = 0;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		if (plan->pTasks[pTask].T == 0) {
+			return 0;
+		}
+		utilization += (double)plan->pTasks[pTask].C / plan->pTasks[pTask].T;
+		next += plan->pTasks[pTask].C;
+	}
+
+	// Rounding can leave a utilization of exactly 1 a hair above it
+	if (utilization > 1.0 + 1e-9) {
+		return 0;
+	}
+
+	// Iterate w = sum(ceil(w / T) * C) up from the first wave of releases until no new release lands inside it
+	while (busy != next) {
+		busy = next;
+		next = 0;
+		for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+			uint64_t period = plan->pTasks[pTask].T;
+			next += (busy + period - 1) / period * plan->pTasks[pTask].C;
+		}
+	}
+	return busy;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns the name a server kind goes by in plan files and reports                                                    |
+//---------------------------------------------------------------------------------------------------------------------+
+const char* ServerName(uint8_t kind) {
+	switch (kind) {
+		case SERVER_POLLING: return "polling";
+		case SERVER_DEFERRABLE: return "deferrable";
+		case SERVER_SPORADIC: return "sporadic";
+		case SERVER_TOTAL_BANDWIDTH: return "tbs";
+		case SERVER_CONSTANT_BANDWIDTH: return "cbs";
+		default: return "none";
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns a server's nominal capacity over a duration: Qs for every period Ts which starts within it (0 for none)     |
+//---------------------------------------------------------------------------------------------------------------------+
+uint64_t ServerCapacity(AperiodicServer* server, simtime_t duration) {
+	if (server->kind == SERVER_NONE) {
+		return 0;
+	}
+	return ((uint64_t)duration + server->period - 1) / server->period * server->budget;
+}
@@ -1,35 +1,198 @@
 #pragma once
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+// Widths of simulation time and of task counts/indices
+// Build with -DWIDE_INTEGERS (make WIDE=1) for 64-bit time and 32-bit task ids, needed past 65535 ticks or 255 tasks
+#ifdef WIDE_INTEGERS
+typedef uint64_t simtime_t;
+typedef uint32_t taskid_t;
+#else
+typedef uint16_t simtime_t;
+typedef uint8_t taskid_t;
+#endif
 
 // Per the assignment description, aperiodic tasks have an implicit deadline of 500ms from the release time
 #define APERIODIC_DEADLINE 500
 
+// One tick of simulation time is one millisecond of CPU
+#define TICK_MICROSECONDS 1000
+
 typedef struct {
-	uint8_t taskIndex;
-	uint8_t columnIndex;
+	taskid_t taskIndex;
+	taskid_t columnIndex;
 	char* ID;
-	uint16_t C;
-	uint16_t T;
+	simtime_t C;
+	simtime_t T;
 } PeriodicTask;
 
 typedef struct {
-	uint8_t taskIndex;
-	uint8_t columnIndex;
+	taskid_t taskIndex;
+	taskid_t columnIndex;
 	char* ID;
-	uint16_t C;
-	uint16_t r;
+	simtime_t C;
+	simtime_t r;
 } AperiodicTask;
 
+// How a simulation stores its timeline (see Schedule in reporter.h)
+enum
+{
+	LAYOUT_DENSE        = 0, // activeTask and flags for every tick (default)
+	LAYOUT_COMPACT      = 1, // execution runs plus a sparse list of status events
+	LAYOUT_COUNTERS     = 2, // no timeline, only the totals the summary statistics are made of
+};
+
+// Whether the analytical schedulability tests are reported alongside (or instead of) the simulated tables
+enum
+{
+	ANALYSIS_NONE       = 0, // simulate only (default)
+	ANALYSIS_APPEND     = 1, // simulate, then report the analysis after the tables
+	ANALYSIS_ONLY       = 2, // skip simulation and report only the analysis verdict
+};
+
+// How each schedule is written out
+enum
+{
+	FORMAT_TABLE        = 0, // the ASCII table (default)
+	FORMAT_BINARY       = 1, // varint-encoded binary trace (see tracer.c)
+	FORMAT_CSV          = 2, // one run or event per line
+	FORMAT_JSONL        = 3, // one JSON object per line
+};
+
+// How the periodic tasks are packed onto the cores in partitioned mode, always in decreasing utilization order
+enum
+{
+	PACKING_FIRST_FIT   = 0, // the first core in order which passes the test (default)
+	PACKING_BEST_FIT    = 1, // the fullest core which passes the test
+	PACKING_WORST_FIT   = 2, // the emptiest core which passes the test
+};
+
+// Whether a forward (work-conserving, as soon as possible) fixed priority schedule is reported after the ALAP one
+enum
+{
+	ASAP_NONE           = 0, // ALAP rate monotonic only (default)
+	ASAP_RATE_MONOTONIC = 1, // rate monotonic priorities, aperiodic jobs in the background
+	ASAP_DEADLINE_MONOTONIC = 2, // deadline monotonic, aperiodic jobs ranked by APERIODIC_DEADLINE among the periodic tasks
+};
+
+// Which server (if any) a plan's aperiodic jobs run under, set by the plan's optional server line
+enum
+{
+	SERVER_NONE         = 0, // aperiodic jobs in the background (RM) or with APERIODIC_DEADLINE (EDF) (default)
+	SERVER_POLLING      = 1, // RM: Qs every Ts, lost as soon as no aperiodic job is waiting
+	SERVER_DEFERRABLE   = 2, // RM: Qs every Ts, kept until used up or the next period
+	SERVER_SPORADIC     = 3, // RM: what is used comes back Ts after the server became ready to use it
+	SERVER_TOTAL_BANDWIDTH = 4, // EDF: each job gets the deadline its C would take at a bandwidth of Qs / Ts
+	SERVER_CONSTANT_BANDWIDTH = 5, // EDF: Qs per server deadline, which moves Ts later whenever it runs out
+};
+
+// An aperiodic server: the budget Qs it may use per period Ts
+typedef struct {
+	uint8_t kind;
+	simtime_t budget;
+	simtime_t period;
+} AperiodicServer;
+
+// Switches which change how a plan is simulated rather than what is simulated
+typedef struct {
+	uint8_t layout;
+	uint8_t extrapolate; // nonzero => copy the schedule forward once it repeats each hyperperiod
+	uint8_t analysis;
+	uint8_t summaryOnly; // nonzero => report only the statistics below each table, not its per-tick rows
+	uint8_t format;
+	uint8_t quiet; // nonzero => don't echo parsed plans
+	uint16_t renderThreads; // above 1 => render the table rows on this many threads into the memory-mapped output
+	uint8_t stats; // nonzero => time each phase and report it (with the engines' counters in a SIM_STATS build)
+	uint16_t cores; // above 1 => partition the tasks over this many processors and simulate each on its own thread
+	uint8_t packing;
+	uint8_t global; // nonzero => EDF runs every core from one ready queue, RM stays partitioned
+	uint8_t resumable; // nonzero => EDF saves its state every so often, so EdfResimulation can resume it after an edit
+	uint8_t asap;
+	uint8_t stopAtMiss; // nonzero => a simulation in the counters layout stops at its first missed deadline
+} SimSettings;
+
 typedef struct {
-	uint16_t duration;
-	uint8_t tasks;
+	simtime_t duration;
+	taskid_t tasks;
+	SimSettings settings;
 	
-	uint8_t pCount;
+	taskid_t pCount;
 	PeriodicTask* pTasks;
 	
-	uint8_t aCount;
+	taskid_t aCount;
 	AperiodicTask* aTasks;
+
+	AperiodicServer server;
+
+	// every task ID is interned in this one allocation
+	char* idArena;
 } SimPlan;
 
-SimPlan* ParsePlan(const char* file);
+// What a PlanEdit changes
+enum
+{
+	EDIT_PERIODIC       = 0, // periodic task `index` takes the new C and T
+	EDIT_APERIODIC      = 1, // aperiodic task `index` takes the new C and release
+	EDIT_ADD_APERIODIC  = 2, // a new aperiodic task named ID is added after the others
+};
+
+// One change to a plan, as made between the runs of a design-space exploration (see EditPlan)
+typedef struct {
+	uint8_t kind;
+	taskid_t index;
+	const char* ID; // EDIT_ADD_APERIODIC only
+	simtime_t C;
+	simtime_t time; // T of a periodic task, r of an aperiodic one
+} PlanEdit;
+
+// How the synthetic generator spreads aperiodic releases over the horizon
+enum
+{
+	ARRIVAL_POISSON     = 0, // exponential gaps averaging duration / (aCount + 1) (default)
+	ARRIVAL_UNIFORM     = 1, // each release independently uniform over the horizon
+	ARRIVAL_BURSTY      = 2, // Poisson bursts of `burst` releases at the same time
+};
+
+// Parameters of a synthetic plan (see generator.c)
+typedef struct {
+	taskid_t pCount;
+	taskid_t aCount;
+	double utilization; // total periodic utilization, split between the tasks with UUniFast
+	simtime_t duration;
+	simtime_t minPeriod; // periods are log-uniform in [minPeriod, maxPeriod]
+	simtime_t maxPeriod;
+	simtime_t aMinC; // aperiodic execution times are uniform in [aMinC, aMaxC]
+	simtime_t aMaxC;
+	uint8_t arrivals;
+	taskid_t burst;
+	uint64_t seed;
+} GenParams;
+
+// A plan file mapped into memory (or read whole when it can't be) and tokenized in place, plans may be stacked in it
+typedef struct {
+	const char* file; // name used when reporting malformed input
+	const char* data;
+	size_t size;
+	size_t pos;
+	size_t line; // 1-based number of the line last read
+	bool mapped;
+	bool quiet; // true => don't echo each parsed plan to stdout
+	bool failed;
+} PlanReader;
+
+SimPlan* ParsePlan(const char* file, bool quiet);
+PlanReader* OpenPlans(const char* file, bool quiet);
+SimPlan* NextPlan(PlanReader* reader);
+void ClosePlans(PlanReader* reader);
+void WritePlan(FILE* fout, SimPlan* plan);
 void CleanPlan(SimPlan* plan);
+SimPlan* EditPlan(SimPlan* plan, PlanEdit* edit);
+simtime_t FirstEditedTick(SimPlan* plan, PlanEdit* edit);
+void DefaultGenParams(GenParams* params);
+SimPlan* GeneratePlan(const GenParams* params, uint64_t seed);
+simtime_t PlanHyperperiod(SimPlan* plan);
+uint64_t PlanBusyPeriod(SimPlan* plan);
+const char* ServerName(uint8_t kind);
+uint64_t ServerCapacity(AperiodicServer* server, simtime_t duration);
@@ -0,0 +1,469 @@
+#include "parser.h"
+#include "reporter.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern Schedule* RmSimulation(SimPlan* plan);
+extern Schedule* EdfSimulation(SimPlan* plan);
+extern Analysis* RmAnalysis(SimPlan* plan);
+extern Analysis* EdfAnalysis(SimPlan* plan);
+extern MultiSchedule* GlobalEdfSimulation(SimPlan* plan, uint16_t cpus);
+extern void CleanEdfSimulation(void);
+extern ScheduleSummary ReportSchedule(SimPlan* plan, FILE* fout, Schedule* sched, const char* title,
+	const char* scheduler);
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Multiprocessor modes                                                                                                |
+//                                                                                                                     |
+// Partitioned: the periodic tasks are packed onto the cores ahead of time and never migrate                           |
+// Each core is an ordinary single processor plan, simulated by the usual engines on a thread of its own               |
+//                                                                                                                     |
+// Global (EDF only): one ready queue feeds every core and jobs migrate, see GlobalEdfSimulation                       |
+//---------------------------------------------------------------------------------------------------------------------+
+
+// The tasks assigned to one core and what they add up to
+typedef struct {
+	SimPlan* plan; // the core's share of the tasks, IDs point into the full plan's arena
+	double utilization; // periodic utilization
+	double load; // periodic utilization plus the aperiodic work per tick, used to spread the aperiodic tasks
+	bool passes; // false => some task failed the test everywhere and was forced onto this core
+} Core;
+
+// One core's simulation as handed to its thread
+typedef struct {
+	SimPlan* plan;
+	Schedule* (*simulate)(SimPlan*);
+	Schedule* sched;
+	SimCounters counters;
+} CoreRun;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - orders periodic tasks by decreasing utilization, then by plan order                                         |
+//---------------------------------------------------------------------------------------------------------------------+
+static int CompareUtilization(const void* a, const void* b) {
+	PeriodicTask* x = *(PeriodicTask**)a;
+	PeriodicTask* y = *(PeriodicTask**)b;
+
+	// C_x / T_x > C_y / T_y without rounding
+	uint64_t left = (uint64_t)x->C * y->T;
+	uint64_t right = (uint64_t)y->C * x->T;
+	if (left != right) {
+		return left > right ? -1 : 1;
+	}
+	return x->taskIndex < y->taskIndex ? -1 : x->taskIndex > y->taskIndex;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - orders a core's periodic tasks back into plan order                                                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static int ComparePlanOrder(const void* a, const void* b) {
+	PeriodicTask* x = (PeriodicTask*)a;
+	PeriodicTask* y = (PeriodicTask*)b;
+	return x->taskIndex < y->taskIndex ? -1 : x->taskIndex > y->taskIndex;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - runs the admission test on a core as if the given task were added to it                                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool CoreAccepts(Core* core, PeriodicTask* task, Analysis* (*test)(SimPlan*)) {
+	SimPlan* plan = core->plan;
+	plan->pTasks[plan->pCount++] = *task;
+
+	// A zero duration keeps the test to its verdict, it doesn't need to look for the first miss within the horizon
+	simtime_t duration = plan->duration;
+	plan->duration = 0;
+	Analysis* analysis = test(plan);
+	bool accepted = analysis->schedulable;
+	CleanAnalysis(analysis);
+	plan->duration = duration;
+
+	--plan->pCount;
+	return accepted;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - picks the core for a task: the first core in packing order which still passes the test with it            |
+// First fit tries the cores in order, best fit the fullest first and worst fit the emptiest first                     |
+// When no core passes, the task goes to the emptiest core regardless and that core is marked as failing               |
+//---------------------------------------------------------------------------------------------------------------------+
+static Core* PlaceTask(Core* cores, uint16_t coreCount, PeriodicTask* task, uint8_t packing,
+	Analysis* (*test)(SimPlan*)) {
+	bool* tried = (bool*)calloc(coreCount, sizeof(bool));
+	Core* chosen = NULL;
+
+	for (uint16_t attempt = 0; attempt < coreCount && chosen == NULL; ++attempt) {
+		Core* next = NULL;
+		for (uint16_t core = 0; core < coreCount; ++core) {
+			if (tried[core]) {
+				continue;
+			}
+			if (next == NULL ||
+				(packing == PACKING_BEST_FIT && cores[core].utilization > next->utilization) ||
+				(packing == PACKING_WORST_FIT && cores[core].utilization < next->utilization)) {
+				next = cores + core;
+			}
+		}
+		tried[next - cores] = true;
+
+		if (CoreAccepts(next, task, test)) {
+			chosen = next;
+		}
+	}
+	free(tried);
+
+	if (chosen == NULL) {
+		chosen = cores;
+		for (uint16_t core = 1; core < coreCount; ++core) {
+			if (cores[core].utilization < chosen->utilization) {
+				chosen = cores + core;
+			}
+		}
+		chosen->passes = false;
+	}
+
+	double utilization = (double)task->C / task->T;
+	chosen->plan->pTasks[chosen->plan->pCount++] = *task;
+	chosen->utilization += utilization;
+	chosen->load += utilization;
+	return chosen;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - packs the periodic tasks onto the cores in decreasing utilization order using the given test per core      |
+// The aperiodic tasks follow in plan order, each onto the least loaded core so far                                    |
+// Every core's tasks end up in plan order and renumbered as a plan of their own                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+static Core* PartitionPlan(SimPlan* plan, uint16_t coreCount, uint8_t packing, Analysis* (*test)(SimPlan*)) {
+	Core* cores = (Core*)calloc(coreCount, sizeof(Core));
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		SimPlan* sub = (SimPlan*)calloc(sizeof(SimPlan), 1);
+		sub->duration = plan->duration;
+		sub->settings = plan->settings;
+		sub->settings.cores = 0;
+		sub->pTasks = (PeriodicTask*)calloc(sizeof(PeriodicTask), plan->pCount + 1);
+		sub->aTasks = (AperiodicTask*)calloc(sizeof(AperiodicTask), plan->aCount + 1);
+		cores[core].plan = sub;
+		cores[core].passes = true;
+	}
+
+	PeriodicTask** order = (PeriodicTask**)malloc(sizeof(PeriodicTask*) * (plan->pCount + 1));
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		order[pTask] = plan->pTasks + pTask;
+	}
+	qsort(order, plan->pCount, sizeof(PeriodicTask*), CompareUtilization);
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		PlaceTask(cores, coreCount, order[pTask], packing, test);
+	}
+	free(order);
+
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		Core* chosen = cores;
+		for (uint16_t core = 1; core < coreCount; ++core) {
+			if (cores[core].load < chosen->load) {
+				chosen = cores + core;
+			}
+		}
+		chosen->plan->aTasks[chosen->plan->aCount++] = plan->aTasks[aTask];
+		chosen->load += (double)plan->aTasks[aTask].C / plan->duration;
+	}
+
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		SimPlan* sub = cores[core].plan;
+		qsort(sub->pTasks, sub->pCount, sizeof(PeriodicTask), ComparePlanOrder);
+		sub->tasks = sub->pCount + sub->aCount;
+		for (taskid_t pTask = 0; pTask < sub->pCount; ++pTask) {
+			sub->pTasks[pTask].taskIndex = pTask;
+			sub->pTasks[pTask].columnIndex = pTask + 1;
+		}
+		for (taskid_t aTask = 0; aTask < sub->aCount; ++aTask) {
+			sub->aTasks[aTask].taskIndex = sub->pCount + aTask;
+			sub->aTasks[aTask].columnIndex = sub->pCount + aTask + 1;
+		}
+	}
+
+	return cores;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - thread body simulating a single core, with the core's own counters                                         |
+//---------------------------------------------------------------------------------------------------------------------+
+static void* CoreWorker(void* arg) {
+	CoreRun* run = (CoreRun*)arg;
+	ResetCounters();
+	run->sched = run->simulate(run->plan);
+	run->counters = TakeCounters();
+
+	// The EDF job pool is per thread and this one may be about to exit
+	CleanEdfSimulation();
+	return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - simulates every core with the given engine, one thread per core (the caller takes the first core)          |
+// The counters of all cores are added into counters                                                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static Schedule** SimulateCores(Core* cores, uint16_t coreCount, Schedule* (*simulate)(SimPlan*),
+	SimCounters* counters) {
+	CoreRun* runs = (CoreRun*)calloc(coreCount, sizeof(CoreRun));
+	pthread_t* threads = (pthread_t*)calloc(coreCount, sizeof(pthread_t));
+	bool* started = (bool*)calloc(coreCount, sizeof(bool));
+
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		runs[core].plan = cores[core].plan;
+		runs[core].simulate = simulate;
+	}
+	for (uint16_t core = 1; core < coreCount; ++core) {
+		started[core] = pthread_create(threads + core, NULL, CoreWorker, runs + core) == 0;
+	}
+
+	// Any core without a thread of its own is simulated here after the first
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		if (!started[core]) {
+			CoreWorker(runs + core);
+		}
+	}
+
+	Schedule** scheds = (Schedule**)malloc(sizeof(Schedule*) * coreCount);
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		if (started[core]) {
+			pthread_join(threads[core], NULL);
+		}
+		scheds[core] = runs[core].sched;
+
+		if (counters != NULL) {
+			counters->ticks += runs[core].counters.ticks;
+			counters->jobsReleased += runs[core].counters.jobsReleased;
+			counters->queueOps += runs[core].counters.queueOps;
+			counters->preemptions += runs[core].counters.preemptions;
+			counters->scanSteps += runs[core].counters.scanSteps;
+		}
+	}
+
+	free(runs);
+	free(threads);
+	free(started);
+	return scheds;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - centers text in a 51 character rule of dashes like the other section titles, with a blank line above      |
+//---------------------------------------------------------------------------------------------------------------------+
+static void FormatTitle(char* out, const char* text) {
+	size_t len = strlen(text) + 2;
+	size_t left = len < 51 ? (51 - len) / 2 : 0;
+	size_t right = len < 51 ? 51 - len - left : 0;
+
+	out += sprintf(out, "\r\n");
+	memset(out, '-', left);
+	out += left;
+	out += sprintf(out, " %s ", text);
+	memset(out, '-', right);
+	out += right;
+	sprintf(out, "\r\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - lists which tasks went to which core and whether every core passes the test                                |
+//---------------------------------------------------------------------------------------------------------------------+
+static void WritePartition(FILE* fout, Core* cores, uint16_t coreCount, const char* packing, const char* test) {
+	fprintf(fout, "Cores: %u (%s decreasing, %s test)\r\n", (unsigned)coreCount, packing, test);
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		SimPlan* sub = cores[core].plan;
+		fprintf(fout, "Core %u (U = %.4f%s):", (unsigned)core, cores[core].utilization,
+			cores[core].passes ? "" : ", fails the test");
+		for (taskid_t pTask = 0; pTask < sub->pCount; ++pTask) {
+			fprintf(fout, " %s", sub->pTasks[pTask].ID);
+		}
+		for (taskid_t aTask = 0; aTask < sub->aCount; ++aTask) {
+			fprintf(fout, " %s", sub->aTasks[aTask].ID);
+		}
+		fprintf(fout, "\r\n");
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - partitions, simulates and reports one scheduler over all cores, returning the combined statistics          |
+// Utilization is the share of the total capacity of all cores, the other figures add up over the cores               |
+//---------------------------------------------------------------------------------------------------------------------+
+static ScheduleSummary SimulatePartition(SimPlan* plan, FILE* fout, const char* title, const char* scheduler,
+	Schedule* (*simulate)(SimPlan*), Analysis* (*test)(SimPlan*), const char* testName, PhaseTimer* timer,
+	PhaseTimer* report, SimCounters* counters) {
+	uint16_t coreCount = plan->settings.cores;
+	static const char* packingNames[] = { "first fit", "best fit", "worst fit" };
+	bool table = plan->settings.format == FORMAT_TABLE || plan->settings.summaryOnly;
+
+	if (timer != NULL) {
+		StartPhase(timer);
+	}
+	Core* cores = PartitionPlan(plan, coreCount, plan->settings.packing, test);
+	Schedule** scheds = SimulateCores(cores, coreCount, simulate, counters);
+	if (timer != NULL) {
+		StopPhase(timer);
+	}
+
+	if (report != NULL) {
+		StartPhase(report);
+	}
+	if (table) {
+		fprintf(fout, "%s", title);
+		WritePartition(fout, cores, coreCount, packingNames[plan->settings.packing % 3], testName);
+	}
+
+	double utilization = 0.0;
+	uint64_t missed = 0, preemptions = 0, responses = 0;
+	for (uint16_t core = 0; core < coreCount; ++core) {
+		char coreText[32], coreTitle[64], coreScheduler[32];
+		snprintf(coreText, sizeof(coreText), "%s on core %u", scheduler, (unsigned)core);
+		snprintf(coreScheduler, sizeof(coreScheduler), "%s/%u", scheduler, (unsigned)core);
+		FormatTitle(coreTitle, coreText);
+
+		ScheduleSummary summary = ReportSchedule(cores[core].plan, fout, scheds[core], coreTitle, coreScheduler);
+		utilization += summary.utilization;
+		missed += summary.missedDeadlines;
+		preemptions += summary.preemptions;
+		responses += scheds[core]->aperiodicResponseTimes;
+
+		CleanSchedule(scheds[core]);
+		CleanPlan(cores[core].plan);
+	}
+	free(scheds);
+	free(cores);
+
+	ScheduleSummary combined;
+	combined.utilization = (float)(utilization / coreCount);
+	combined.missedDeadlines = missed;
+	combined.preemptions = preemptions;
+	combined.aperiodicResponse = plan->aCount > 0 ? responses / (float)plan->aCount : NAN;
+	if (table) {
+		char text[32], title[64];
+		snprintf(text, sizeof(text), "%s over all %u cores", scheduler, (unsigned)coreCount);
+		FormatTitle(title, text);
+		fprintf(fout, "%s", title);
+		WriteSummary(fout, &combined);
+	}
+	if (report != NULL) {
+		StopPhase(report);
+	}
+
+	return combined;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - simulates and reports global EDF over all cores, returning the combined statistics                         |
+// Each CPU's lane is reported like a schedule of its own, followed by the combined figures and each task's counts     |
+//---------------------------------------------------------------------------------------------------------------------+
+static ScheduleSummary SimulateGlobal(SimPlan* plan, FILE* fout, PhaseTimer* timer, PhaseTimer* report,
+	SimCounters* counters) {
+	uint16_t cpus = plan->settings.cores;
+	bool table = plan->settings.format == FORMAT_TABLE || plan->settings.summaryOnly;
+
+	if (timer != NULL) {
+		ResetCounters();
+		StartPhase(timer);
+	}
+	MultiSchedule* multi = GlobalEdfSimulation(plan, cpus);
+	if (timer != NULL) {
+		StopPhase(timer);
+		*counters = TakeCounters();
+	}
+
+	if (report != NULL) {
+		StartPhase(report);
+	}
+	if (table) {
+		fprintf(fout, "--------- Global Earliest Deadline First ----------\r\n");
+		fprintf(fout, "CPUs: %u (one ready queue, migration allowed)\r\n", (unsigned)cpus);
+	}
+
+	double utilization = 0.0;
+	uint64_t missed = 0, preemptions = 0;
+	for (uint16_t cpu = 0; cpu < cpus; ++cpu) {
+		char cpuText[32], cpuTitle[64], cpuScheduler[32];
+		snprintf(cpuText, sizeof(cpuText), "EDF on CPU %u", (unsigned)cpu);
+		snprintf(cpuScheduler, sizeof(cpuScheduler), "GEDF/%u", (unsigned)cpu);
+		FormatTitle(cpuTitle, cpuText);
+
+		ScheduleSummary summary = ReportSchedule(plan, fout, multi->lanes[cpu], cpuTitle, cpuScheduler);
+		utilization += summary.utilization;
+		missed += summary.missedDeadlines;
+		preemptions += summary.preemptions;
+	}
+
+	ScheduleSummary combined;
+	combined.utilization = (float)(utilization / cpus);
+	combined.missedDeadlines = missed;
+	combined.preemptions = preemptions;
+	combined.aperiodicResponse = plan->aCount > 0 ? multi->aperiodicResponseTimes / (float)plan->aCount : NAN;
+
+	if (table) {
+		char text[32], title[64];
+		snprintf(text, sizeof(text), "EDF over all %u CPUs", (unsigned)cpus);
+		FormatTitle(title, text);
+		fprintf(fout, "%s", title);
+		WriteSummary(fout, &combined);
+
+		fprintf(fout, "\r\n%-12s %12s %12s\r\n", "Task", "Preemptions", "Migrations");
+		for (taskid_t task = 0; task < plan->tasks; ++task) {
+			fprintf(fout, "%-12s %12llu %12llu\r\n", multi->lanes[0]->header[task],
+				(unsigned long long)multi->preemptions[task], (unsigned long long)multi->migrations[task]);
+		}
+	}
+	else if (plan->settings.format == FORMAT_JSONL) {
+		for (taskid_t task = 0; task < plan->tasks; ++task) {
+			fprintf(fout, "{\"scheduler\":\"GEDF\",\"type\":\"task\",\"task\":\"%s\",\"preemptions\":%llu,\"migrations\":%llu}\n",
+				multi->lanes[0]->header[task], (unsigned long long)multi->preemptions[task],
+				(unsigned long long)multi->migrations[task]);
+		}
+	}
+	if (report != NULL) {
+		StopPhase(report);
+	}
+
+	CleanMultiSchedule(multi);
+	return combined;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Simulates the plan partitioned over settings.cores processors, once packed with the response time test for RM and  |
+// once with the demand test for EDF (or globally for EDF with settings.global), and writes each core's schedule       |
+// followed by the combined statistics                                                                                 |
+// The summary statistics of each scheduler are optionally returned through rm and edf, the phase timers through stats |
+//---------------------------------------------------------------------------------------------------------------------+
+void SimulatePartitioned(SimPlan* plan, FILE* fout, ScheduleSummary* rm, ScheduleSummary* edf, SimStats* stats) {
+	if (plan->settings.summaryOnly) {
+		WriteTraceHeader(fout, FORMAT_TABLE);
+	}
+	else {
+		WriteTraceHeader(fout, plan->settings.format);
+	}
+
+	ScheduleSummary rmSummary = SimulatePartition(plan, fout,
+		"----------- Partitioned Rate Monotonic ------------\r\n", "RM", RmSimulation, RmAnalysis, "response time",
+		stats != NULL ? &stats->rmSimulation : NULL, stats != NULL ? &stats->report : NULL,
+		stats != NULL ? &stats->rm : NULL);
+	if (plan->settings.format == FORMAT_TABLE || plan->settings.summaryOnly) {
+		fprintf(fout, "\r\n");
+	}
+
+	ScheduleSummary edfSummary;
+	if (plan->settings.global) {
+		edfSummary = SimulateGlobal(plan, fout, stats != NULL ? &stats->edfSimulation : NULL,
+			stats != NULL ? &stats->report : NULL, stats != NULL ? &stats->edf : NULL);
+	}
+	else {
+		edfSummary = SimulatePartition(plan, fout,
+			"------- Partitioned Earliest Deadline First -------\r\n", "EDF", EdfSimulation, EdfAnalysis, "demand",
+			stats != NULL ? &stats->edfSimulation : NULL, stats != NULL ? &stats->report : NULL,
+			stats != NULL ? &stats->edf : NULL);
+	}
+
+	if (rm != NULL) {
+		*rm = rmSummary;
+	}
+	if (edf != NULL) {
+		*edf = edfSummary;
+	}
+}
@@ -1,12 +1,18 @@
 #include "parser.h"
 #include "reporter.h"
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern void CleanSavedStates(struct SavedStates* states);
 
 //---------------------------------------------------------------------------------------------------------------------+
 // Outputs a positive integer to the given column in the table (0 - 9999)                                              |
 //---------------------------------------------------------------------------------------------------------------------+
-static inline void colCounter(char* col, uint16_t n) {
+static inline void colCounter(char* col, uint64_t n) {
 	// Two spaces before the number
 	col[0] = col[1] = ' ';
 
@@ -21,237 +27,750 @@ static inline void colCounter(char* col, uint16_t n) {
 	col[6] = col[7] = ' ';
 }
 
+// Table rows are gathered into blocks of this size so the file sees a few large writes rather than one per tick
+#define OUTPUT_BLOCK_SIZE (1 << 20)
+
+// Output block which rows are rendered into, written out whenever the next rows would not fit
+typedef struct {
+	FILE* fout;
+	char* block;
+	size_t used;
+	size_t capacity;
+} RowWriter;
+
+// Counters gathered while rendering rows (one set per thread when rendering in parallel)
+typedef struct {
+	uint64_t utilization;
+	simtime_t* dCount;
+	simtime_t* pCount;
+} RowCounts;
+
+// One thread's share of a parallel render: a range of ticks and where in the mapped file their rows go
+typedef struct {
+	Schedule* sched;
+	simtime_t from;
+	simtime_t to;
+	char* out;
+	size_t tableWidth;
+	RowCounts counts;
+} RenderJob;
+
+// The status each of the dense layout's bitplanes stands for
+static const char planeStatus[STATUS_PLANES] = { STATUS_RELEASED, STATUS_PREEMPTED, STATUS_OVERDUE };
+
 //---------------------------------------------------------------------------------------------------------------------+
-// Generates the output table in the given file for a fully generated schedule                                         |
+// Helper - the first of a task's bitplanes in the dense layout, the others follow planeWords apart                    |
 //---------------------------------------------------------------------------------------------------------------------+
-void WriteSchedule(FILE* fout, Schedule* sched) {
-	uint8_t* activeTask = sched->activeTask;
-	char* flags = sched->flags;
-
-	//                     9 => 8-char wide column plus one edge of the column border
-	//                                       + 1 for the time column
-	//                                             + 1 for the table edge
-	uint16_t tableWidth = (9 * (sched->tasks + 1)) + 1;
+static inline uint64_t* TaskPlanes(Schedule* sched, taskid_t taskIndex) {
+	return sched->planes + ((size_t)taskIndex * STATUS_PLANES * sched->planeWords);
+}
 
-	//                                    + 3 for \r\n\0
-	char* buff = (char*)malloc(tableWidth + 3);
-	memcpy(buff + tableWidth, "\r\n\0", 3);
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - a word with its lowest n bits set (n <= 64)                                                                |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline uint64_t LowBits(uint64_t n) {
+	return n >= 64 ? ~0ull : (1ull << n) - 1;
+}
 
-	// Counter variable for utilization
-	uint16_t utilization = 0;
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - the n bits (n <= 64) of a plane from the given tick on, in the low bits of the result (the rest are junk)  |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline uint64_t ReadBits(const uint64_t* plane, uint64_t from, uint64_t n) {
+	uint64_t offset = from & 63;
+	uint64_t bits = plane[from >> 6] >> offset;
+	if (offset != 0 && offset + n > 64) {
+		bits |= plane[(from >> 6) + 1] << (64 - offset);
+	}
+	return bits;
+}
 
-	// Counter variables for preemption and missed deadlines
-	uint8_t* pCount = (uint8_t*)calloc(sizeof(uint8_t), sched->tasks);
-	uint8_t* dCount = (uint8_t*)calloc(sizeof(uint8_t), sched->tasks);
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - copies n bits of a plane starting at tick `from` over those of another plane starting at tick `to`         |
+// The ranges must not overlap, the bits around the copied range are kept                                              |
+//---------------------------------------------------------------------------------------------------------------------+
+static void CopyBits(uint64_t* dst, uint64_t to, const uint64_t* src, uint64_t from, uint64_t n) {
+	while (n > 0) {
+		// Up to the end of the destination word
+		uint64_t offset = to & 63;
+		uint64_t chunk = 64 - offset < n ? 64 - offset : n;
+		uint64_t mask = LowBits(chunk) << offset;
+		dst[to >> 6] = (dst[to >> 6] & ~mask) | ((ReadBits(src, from, chunk) << offset) & mask);
+		to += chunk;
+		from += chunk;
+		n -= chunk;
+	}
+}
 
-	// Generate the first row of the table: "+---+"
-	{
-		buff[0] = buff[tableWidth - 1] = '+';
-		for (uint16_t i = 1; i < tableWidth - 1; ++i) {
-			buff[i] = '-';
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - sets the bits of a plane at ticks first, first + period, ... before end, storing each word only once       |
+//---------------------------------------------------------------------------------------------------------------------+
+static void SetEvery(uint64_t* plane, uint64_t first, uint64_t period, uint64_t end) {
+	uint64_t tick = first;
+	while (tick < end) {
+		uint64_t word = tick >> 6;
+		uint64_t wordEnd = (word + 1) << 6 < end ? (word + 1) << 6 : end;
+		uint64_t bits = 0;
+		for (; tick < wordEnd; tick += period) {
+			bits |= 1ull << (tick & 63);
 		}
-		fprintf(fout, "%s", buff);
+		plane[word] |= bits;
 	}
+}
 
-	// Generate the column header: "|  Time  | TaskId |  ....  |"
-	{
-		memcpy(buff, "|  Time  | ", 10);
-		char* current = buff + 10;
-		for (uint8_t task = 0; task < sched->tasks; ++task) {
-			// Fills each column header with a given id text truncated to 6 digits and centered
-			// Includes spaces on either side and a right side column separator
-			char* id = sched->header[task];
-			size_t len = strlen(id);
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - counts the bits of a plane set over ticks [from, to)                                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+static uint64_t CountBits(const uint64_t* plane, uint64_t from, uint64_t to) {
+	uint64_t count = 0;
+	while (from < to) {
+		uint64_t offset = from & 63;
+		uint64_t chunk = 64 - offset < to - from ? 64 - offset : to - from;
+		count += (uint64_t)__builtin_popcountll(plane[from >> 6] & (LowBits(chunk) << offset));
+		from += chunk;
+	}
+	return count;
+}
 
-			// Left side space
-			*current = ' ';
-			++current;
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - writes out whatever the block holds                                                                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void FlushRows(RowWriter* writer) {
+	fwrite(writer->block, 1, writer->used, writer->fout);
+	writer->used = 0;
+}
 
-			if (len >= 6) {
-				// The (potentially) truncated id
-				memcpy(current, id, 6);
-			}
-			else {
-				// spaces prepended to the id
-				size_t lhs = (6 - len) / 2;
-				for (size_t j = 0; j < lhs; ++j) {
-					current[j] = ' ';
-				}
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - reserves the given number of bytes at the end of the block to render into, writing it out first if full    |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline char* ReserveRows(RowWriter* writer, size_t length) {
+	if (writer->used + length > writer->capacity) {
+		FlushRows(writer);
+	}
+	char* rows = writer->block + writer->used;
+	writer->used += length;
+	return rows;
+}
 
-				// The centered id
-				memcpy(current + lhs, id, len);
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - renders a horizontal rule: "+---+" for the table edges, "|---|---|" between its sections                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RenderRule(char* row, size_t tableWidth, bool edge) {
+	for (size_t i = 0; i < tableWidth; ++i) {
+		row[i] = i % 9 == 0 && !edge ? '|' : '-';
+	}
+	if (edge) {
+		row[0] = row[tableWidth - 1] = '+';
+	}
+	memcpy(row + tableWidth, "\r\n", 2);
+}
 
-				// spaces appended to the id
-				for (size_t j = lhs + len; j < 6; ++j) {
-					current[j] = ' ';
-				}
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - renders the three rows above the data: top edge, column header ("|  Time  | TaskId |  ....  |"), rule      |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RenderHeader(Schedule* sched, char* out, size_t tableWidth) {
+	size_t rowWidth = tableWidth + 2;
+
+	RenderRule(out, tableWidth, true);
+
+	char* buff = out + rowWidth;
+	memcpy(buff, "|  Time  | ", 10);
+	char* current = buff + 10;
+	for (taskid_t task = 0; task < sched->tasks; ++task) {
+		// Fills each column header with a given id text truncated to 6 digits and centered
+		// Includes spaces on either side and a right side column separator
+		char* id = sched->header[task];
+		size_t len = strlen(id);
+
+		// Left side space
+		*current = ' ';
+		++current;
+
+		if (len >= 6) {
+			// The (potentially) truncated id
+			memcpy(current, id, 6);
+		}
+		else {
+			// spaces prepended to the id
+			size_t lhs = (6 - len) / 2;
+			for (size_t j = 0; j < lhs; ++j) {
+				current[j] = ' ';
 			}
-			current = current + 6;
 
-			// Right side space and column edge
-			memcpy(current, " |", 2);
-			current = current + 2;
+			// The centered id
+			memcpy(current + lhs, id, len);
+
+			// spaces appended to the id
+			for (size_t j = lhs + len; j < 6; ++j) {
+				current[j] = ' ';
+			}
 		}
-		fprintf(fout, "%s", buff);
+		current = current + 6;
+
+		// Right side space and column edge
+		memcpy(current, " |", 2);
+		current = current + 2;
 	}
+	memcpy(buff + tableWidth, "\r\n", 2);
 
-	// Generate separator row: "|---|---|---|"
-	{
-		for (uint16_t i = 0; i < tableWidth; ++i) {
-			buff[i] = i % 9 == 0 ? '|' : '-';
+	RenderRule(out + 2 * rowWidth, tableWidth, false);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - renders the data rows of ticks [from, to) into consecutive rows at out, adding what they show to counts     |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RenderRows(Schedule* sched, simtime_t from, simtime_t to, char* out, size_t tableWidth, RowCounts* counts) {
+	size_t rowWidth = tableWidth + 2;
+	taskid_t* activeTask = sched->activeTask;
+
+	// Cursors into the compact layout (unused for the dense layout), started at the first run and event not before from
+	ScheduleRun* run = sched->runs;
+	ScheduleRun* runEnd = sched->runs + sched->runCount;
+	ScheduleEvent* event = sched->events;
+	ScheduleEvent* eventEnd = sched->events + sched->eventCount;
+	if (activeTask == NULL) {
+		size_t lo = 0, hi = sched->runCount;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (sched->runs[mid].end <= from) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
+		}
+		run += lo;
+
+		lo = 0, hi = sched->eventCount;
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
+			if (sched->events[mid].time < from) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
 		}
-		fprintf(fout, "%s", buff);
+		event += lo;
+	}
+
+	// Every row starts out blank: column edges and spaces
+	char* blank = (char*)malloc(rowWidth);
+	for (size_t i = 0; i < tableWidth; ++i) {
+		blank[i] = i % 9 == 0 ? '|' : ' ';
 	}
+	memcpy(blank + tableWidth, "\r\n", 2);
+
+	char* rows = out;
+	for (simtime_t now = from; now < to; ++now, out += rowWidth) {
+		char* buff = out;
+		memcpy(buff, blank, rowWidth);
 
-	// Output data
-	for (uint16_t now = 0; now < sched->duration; ++now) {
 		// Print the time
 		colCounter(buff + 1, now);
 
-		// Clear each column
-		for (uint8_t task = 0; task < sched->tasks; ++task) {
-			//          + 1 => Skip the left table edge
-			//                 9 * => each column is 8 digits wide plus a column edge
-			//                           + 1 => skip the time column
-			memcpy(buff + 1 + (9 * (task + 1)), "        ", 8);
+		// Star the actively running task
+		taskid_t active = 0;
+		if (activeTask != NULL) {
+			active = activeTask[now];
+		}
+		else {
+			while (run < runEnd && run->end <= now) {
+				++run;
+			}
+			if (run < runEnd && run->start <= now) {
+				active = run->task;
+			}
 		}
 
-		// Star the actively running task
-		uint8_t active = activeTask[now];
 		if (active != 0 && active <= sched->tasks) {
-			++utilization;
+			++(counts->utilization);
 
 			// Compiler should simplify the arithmetic to two operations, left more for clarity
 			buff[1 + (9 * (active)) + 4] = '*';
 		}
 
-		// Apply other flags to all relevant tasks
-		for (uint8_t task = 0; task < sched->tasks; ++task) {
-			char flag = flags[(now * sched->tasks) + task];
+		// Apply other flags to all relevant tasks (the dense layout's are applied below)
+		if (sched->planes == NULL) {
+			// Every other cell is still blank
+			for (; event < eventEnd && event->time == now; ++event) {
+				taskid_t task = event->taskIndex;
 
-			switch (flag) {
-				case STATUS_OVERDUE:
-					++(dCount[task]);
-					break;
-				case STATUS_PREEMPTED:
-					++(pCount[task]);
-					break;
-			}
+				switch (event->status) {
+					case STATUS_OVERDUE:
+						++(counts->dCount[task]);
+						break;
+					case STATUS_PREEMPTED:
+						++(counts->pCount[task]);
+						break;
+				}
 
-			// Compiler should simplify the arithmetic to two operations, left more for clarity
-			buff[1 + (9 * (task + 1)) + 3] = flag;
+				buff[1 + (9 * (task + 1)) + 3] = event->status;
+			}
 		}
-
-		fprintf(fout, "%s", buff);
 	}
 
-	uint8_t dTotal = 0;
-	uint8_t pTotal = 0;
+	// Dense layout: the blank cells are already rendered, so only the set bits of the planes are visited, a word's worth
+	// of rows at a time
+	for (uint64_t now = from; sched->planes != NULL && now < to;) {
+		uint64_t word = now >> 6;
+		uint64_t chunk = 64 - (now & 63) < to - now ? 64 - (now & 63) : to - now;
+		uint64_t mask = LowBits(chunk) << (now & 63);
+
+		for (taskid_t task = 0; task < sched->tasks; ++task) {
+			uint64_t* planes = TaskPlanes(sched, task) + word;
+			counts->dCount[task] += __builtin_popcountll(planes[PLANE_OVERDUE * sched->planeWords] & mask);
+			counts->pCount[task] += __builtin_popcountll(planes[PLANE_PREEMPTED * sched->planeWords] & mask);
 
-	// Generate separator row: "|---|---|---|"
-	{
-		for (uint16_t i = 0; i < tableWidth; ++i) {
-			buff[i] = i % 9 == 0 ? '|' : '-';
+			for (size_t plane = 0; plane < STATUS_PLANES; ++plane) {
+				for (uint64_t bits = planes[plane * sched->planeWords] & mask; bits != 0; bits &= bits - 1) {
+					size_t row = (size_t)((word << 6) + (uint64_t)__builtin_ctzll(bits) - from);
+					rows[(row * rowWidth) + 1 + (9 * (task + 1)) + 3] = planeStatus[plane];
+				}
+			}
 		}
-		fprintf(fout, "%s", buff);
+		now += chunk;
 	}
 
+	free(blank);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - renders the four rows below the data: rule, dCount and pCount stats, bottom edge                           |
+//---------------------------------------------------------------------------------------------------------------------+
+static void RenderFooter(Schedule* sched, char* out, size_t tableWidth, RowCounts* counts) {
+	size_t rowWidth = tableWidth + 2;
+
+	RenderRule(out, tableWidth, false);
+
 	// Generate dCount stats row
-	{
-		memcpy(buff + 1, " dCount ", 8);
+	char* buff = out + rowWidth;
+	memcpy(buff, out, rowWidth);
+	memcpy(buff + 1, " dCount ", 8);
+	for (taskid_t task = 0; task < sched->tasks; ++task) {
+		colCounter(buff + 1 + (9 * (task + 1)), counts->dCount[task]);
+	}
+
+	// Generate pCount stats row
+	buff = out + 2 * rowWidth;
+	memcpy(buff, out, rowWidth);
+	memcpy(buff + 1, " pCount ", 8);
+	for (taskid_t task = 0; task < sched->tasks; ++task) {
+		colCounter(buff + 1 + (9 * (task + 1)), counts->pCount[task]);
+	}
+
+	RenderRule(out + 3 * rowWidth, tableWidth, true);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - turns the counts gathered over the whole table into the summary statistics                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+static ScheduleSummary SummarizeCounts(Schedule* sched, RowCounts* counts) {
+	uint64_t dTotal = 0;
+	uint64_t pTotal = 0;
+	for (taskid_t task = 0; task < sched->tasks; ++task) {
+		dTotal += counts->dCount[task];
+		pTotal += counts->pCount[task];
+	}
+
+	ScheduleSummary summary;
+	summary.utilization = ((float)counts->utilization) / sched->duration;
+	summary.missedDeadlines = dTotal;
+	summary.preemptions = pTotal;
+	summary.aperiodicResponse = sched->aperiodicResponseTimes / (float)sched->aCount;
+	return summary;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Prints the summary statistics found below each table                                                                |
+//---------------------------------------------------------------------------------------------------------------------+
+void WriteSummary(FILE* fout, ScheduleSummary* summary) {
+	fprintf(fout,
+		"Utilization: %.4f\r\n"
+		"Missed Deadlines: %llu\r\n"
+		"Preemption Count: %llu\r\n"
+		"Average response time of aperiodic tasks: %.2f\r\n",
+		summary->utilization,
+		(unsigned long long)summary->missedDeadlines,
+		(unsigned long long)summary->preemptions,
+		summary->aperiodicResponse);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes how much of its budget the schedule's aperiodic server used, as a line of text or JSON depending on format   |
+// The budget is the same for every kind: Qs for each period Ts starting within the duration, whatever was refilled    |
+// TBS and CBS may go past it (a share above 1) as EDF also runs them on time the periodic tasks leave idle            |
+// Writes nothing when no server ran, or for the CSV and binary traces whose layout has no place for it                |
+//---------------------------------------------------------------------------------------------------------------------+
+void WriteServerUsage(FILE* fout, Schedule* sched, const char* scheduler, uint8_t format) {
+	if (sched->server == SERVER_NONE) {
+		return;
+	}
 
-		for (uint8_t task = 0; task < sched->tasks; ++task) {
-			uint8_t cnt = dCount[task];
-			dTotal += cnt;
-			colCounter(buff + 1 + (9 * (task + 1)), cnt);
+	double share = sched->serverBudget > 0 ? (double)sched->serverUsed / sched->serverBudget : 0;
+	if (format == FORMAT_TABLE) {
+		fprintf(fout, "Server budget used (%s): %llu of %llu (%.4f)\r\n", ServerName(sched->server),
+			(unsigned long long)sched->serverUsed, (unsigned long long)sched->serverBudget, share);
+	}
+	else if (format == FORMAT_JSONL) {
+		fprintf(fout, "{\"scheduler\":\"%s\",\"type\":\"server\",\"kind\":\"%s\",\"budget\":%llu,\"used\":%llu}\n",
+			scheduler, ServerName(sched->server), (unsigned long long)sched->serverBudget,
+			(unsigned long long)sched->serverUsed);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Computes the summary statistics of a finished schedule without rendering any of its table                           |
+//---------------------------------------------------------------------------------------------------------------------+
+ScheduleSummary SummarizeSchedule(Schedule* sched) {
+	uint64_t utilization = 0, dTotal = 0, pTotal = 0;
+
+	// The counters layout kept the totals as it went
+	if (sched->statuses != NULL) {
+		utilization = sched->busyTicks;
+		dTotal = sched->missCount;
+		pTotal = sched->preemptCount;
+	}
+	else if (sched->activeTask != NULL) {
+		for (simtime_t now = 0; now < sched->duration; ++now) {
+			taskid_t active = sched->activeTask[now];
+			utilization += active != 0 && active <= sched->tasks;
+		}
+		for (taskid_t task = 0; task < sched->tasks; ++task) {
+			uint64_t* planes = TaskPlanes(sched, task);
+			dTotal += CountBits(planes + (PLANE_OVERDUE * sched->planeWords), 0, sched->duration);
+			pTotal += CountBits(planes + (PLANE_PREEMPTED * sched->planeWords), 0, sched->duration);
+		}
+	}
+	else {
+		for (size_t run = 0; run < sched->runCount; ++run) {
+			if (sched->runs[run].task != 0 && sched->runs[run].task <= sched->tasks) {
+				utilization += sched->runs[run].end - sched->runs[run].start;
+			}
+		}
+		for (size_t event = 0; event < sched->eventCount; ++event) {
+			dTotal += sched->events[event].status == STATUS_OVERDUE;
+			pTotal += sched->events[event].status == STATUS_PREEMPTED;
 		}
-		fprintf(fout, "%s", buff);
 	}
 
-	// Generate pCount stats row
-	{
-		memcpy(buff + 1, " pCount ", 8);
+	ScheduleSummary summary;
+	summary.utilization = ((float)utilization) / sched->duration;
+	summary.missedDeadlines = dTotal;
+	summary.preemptions = pTotal;
+	summary.aperiodicResponse = sched->aperiodicResponseTimes / (float)sched->aCount;
+	return summary;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Generates the output table in the given file for a fully generated schedule                                         |
+// Returns the summary statistics printed below the table                                                              |
+//---------------------------------------------------------------------------------------------------------------------+
+ScheduleSummary WriteSchedule(FILE* fout, Schedule* sched) {
+	//                     9 => 8-char wide column plus one edge of the column border
+	//                                       + 1 for the time column
+	//                                             + 1 for the table edge
+	size_t tableWidth = (9 * ((size_t)sched->tasks + 1)) + 1;
+
+	//                                    + 2 for \r\n
+	size_t rowWidth = tableWidth + 2;
+
+	// Rows are rendered straight into the output block, which always fits the header or footer
+	RowWriter writer;
+	writer.fout = fout;
+	writer.capacity = 4 * rowWidth > OUTPUT_BLOCK_SIZE ? 4 * rowWidth : OUTPUT_BLOCK_SIZE;
+	writer.block = (char*)malloc(writer.capacity);
+	writer.used = 0;
+
+	// Counter variables for utilization, preemption and missed deadlines
+	RowCounts counts;
+	counts.utilization = 0;
+	counts.pCount = (simtime_t*)calloc(sizeof(simtime_t), sched->tasks + 1);
+	counts.dCount = (simtime_t*)calloc(sizeof(simtime_t), sched->tasks + 1);
+
+	RenderHeader(sched, ReserveRows(&writer, 3 * rowWidth), tableWidth);
+
+	// Output data, a block's worth of rows at a time
+	size_t rowsPerBlock = writer.capacity / rowWidth;
+	for (uint64_t from = 0; from < sched->duration;) {
+		uint64_t rows = sched->duration - from < rowsPerBlock ? sched->duration - from : rowsPerBlock;
+		RenderRows(sched, from, from + rows, ReserveRows(&writer, rows * rowWidth), tableWidth, &counts);
+		from += rows;
+	}
+
+	RenderFooter(sched, ReserveRows(&writer, 4 * rowWidth), tableWidth, &counts);
+	FlushRows(&writer);
+
+	// Print the summary statistics
+	ScheduleSummary summary = SummarizeCounts(sched, &counts);
+	WriteSummary(fout, &summary);
+
+	free(counts.dCount);
+	free(counts.pCount);
+	free(writer.block);
+
+	return summary;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - thread entry point rendering one job's range of rows                                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+static void* RenderWorker(void* arg) {
+	RenderJob* job = (RenderJob*)arg;
+	RenderRows(job->sched, job->from, job->to, job->out, job->tableWidth, &job->counts);
+	return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Same output as WriteSchedule, but the table is rendered in place by several threads into the memory-mapped file     |
+// Every row has the same width, so the file is sized up front and each thread formats its own range of ticks          |
+// Falls back to WriteSchedule when the file cannot be mapped (e.g. a pipe, or opened without read access)             |
+//---------------------------------------------------------------------------------------------------------------------+
+ScheduleSummary WriteScheduleParallel(FILE* fout, Schedule* sched, unsigned threads) {
+	size_t tableWidth = (9 * ((size_t)sched->tasks + 1)) + 1;
+	size_t rowWidth = tableWidth + 2;
+	size_t tableSize = rowWidth * ((size_t)sched->duration + 7);
 
-		for (uint8_t task = 0; task < sched->tasks; ++task) {
-			uint8_t cnt = pCount[task];
-			pTotal += cnt;
-			colCounter(buff + 1 + (9 * (task + 1)), cnt);
+	if (threads > sched->duration) {
+		threads = sched->duration;
+	}
+	if (threads < 2 || fflush(fout) != 0) {
+		return WriteSchedule(fout, sched);
+	}
+
+	// Map the table's extent of the file from the page containing the current position
+	int fd = fileno(fout);
+	off_t offset = ftello(fout);
+	if (fd < 0 || offset < 0 || ftruncate(fd, offset + tableSize) != 0) {
+		return WriteSchedule(fout, sched);
+	}
+	off_t mapStart = offset - offset % sysconf(_SC_PAGESIZE);
+	size_t mapSize = tableSize + (offset - mapStart);
+	char* map = (char*)mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mapStart);
+	if (map == MAP_FAILED) {
+		ftruncate(fd, offset);
+		return WriteSchedule(fout, sched);
+	}
+	char* table = map + (offset - mapStart);
+
+	RenderHeader(sched, table, tableWidth);
+
+	// Split the ticks evenly, the calling thread renders the first range itself
+	RenderJob* jobs = (RenderJob*)malloc(sizeof(RenderJob) * threads);
+	pthread_t* workers = (pthread_t*)malloc(sizeof(pthread_t) * threads);
+	bool* started = (bool*)calloc(threads, sizeof(bool));
+	for (unsigned thread = 0; thread < threads; ++thread) {
+		RenderJob* job = jobs + thread;
+		job->sched = sched;
+		job->from = (simtime_t)((uint64_t)sched->duration * thread / threads);
+		job->to = (simtime_t)((uint64_t)sched->duration * (thread + 1) / threads);
+		job->out = table + rowWidth * (3 + (size_t)job->from);
+		job->tableWidth = tableWidth;
+		job->counts.utilization = 0;
+		job->counts.pCount = (simtime_t*)calloc(sizeof(simtime_t), sched->tasks + 1);
+		job->counts.dCount = (simtime_t*)calloc(sizeof(simtime_t), sched->tasks + 1);
+
+		if (thread > 0) {
+			started[thread] = pthread_create(workers + thread, NULL, RenderWorker, job) == 0;
 		}
+	}
 
-		fprintf(fout, "%s", buff);
+	// Any range without a thread of its own is rendered here after the first
+	for (unsigned thread = 0; thread < threads; ++thread) {
+		if (!started[thread]) {
+			RenderWorker(jobs + thread);
+		}
 	}
 
-	// Generate the last row of the table: "+---+"
-	{
-		buff[0] = buff[tableWidth - 1] = '+';
-		for (uint16_t i = 1; i < tableWidth - 1; ++i) {
-			buff[i] = '-';
+	// Reduce the partial counts into the first job's
+	RowCounts* counts = &jobs[0].counts;
+	for (unsigned thread = 1; thread < threads; ++thread) {
+		if (started[thread]) {
+			pthread_join(workers[thread], NULL);
+		}
+
+		counts->utilization += jobs[thread].counts.utilization;
+		for (taskid_t task = 0; task < sched->tasks; ++task) {
+			counts->dCount[task] += jobs[thread].counts.dCount[task];
+			counts->pCount[task] += jobs[thread].counts.pCount[task];
 		}
-		fprintf(fout, "%s", buff);
 	}
 
+	RenderFooter(sched, table + rowWidth * (3 + (size_t)sched->duration), tableWidth, counts);
+	munmap(map, mapSize);
+
+	// Continue the file after the table
+	fseeko(fout, offset + tableSize, SEEK_SET);
+
 	// Print the summary statistics
-	fprintf(fout,
-		"Utilization: %.4f\r\n"
-		"Missed Deadlines: %i\r\n"
-		"Preemption Count: %i\r\n"
-		"Average response time of aperiodic tasks: %.2f\r\n",
-		((float)utilization) / sched->duration,
-		dTotal,
-		pTotal,
-		(sched->aperiodicResponseTimes / (float)sched->aCount));
+	ScheduleSummary summary = SummarizeCounts(sched, counts);
+	WriteSummary(fout, &summary);
 
-	free(dCount);
-	free(pCount);
-	free(buff);
+	for (unsigned thread = 0; thread < threads; ++thread) {
+		free(jobs[thread].counts.dCount);
+		free(jobs[thread].counts.pCount);
+	}
+	free(workers);
+	free(started);
+	free(jobs);
+
+	return summary;
 }
 
 //---------------------------------------------------------------------------------------------------------------------+
-// Dynamically allocates (must call CleanSchedule) space for a schedule with the right dimensions and a clean state    |
-// Also pre-fills the schedule with the released flag since it's convienient and independent of the type of schedule   |
+// Helper - allocates a schedule with the plan's dimensions and headers, but no timeline in either layout yet          |
 //---------------------------------------------------------------------------------------------------------------------+
-Schedule* MakeSchedule(SimPlan* plan) {
+static Schedule* NewSchedule(SimPlan* plan) {
 	Schedule* sched = (Schedule*)malloc(sizeof(Schedule));
 	sched->duration = plan->duration;
 	sched->tasks = plan->tasks;
 
-	// Create active task table (calloc initializes to 0 => slack)
-	sched->activeTask = (uint8_t*)calloc(sizeof(uint8_t), sched->duration);
+	// Start the compact layout empty, it grows as the simulation emits runs and events
+	sched->runs = NULL;
+	sched->runCount = sched->runCapacity = 0;
+	sched->events = NULL;
+	sched->eventCount = sched->eventCapacity = 0;
+	sched->sortedEvents = 0;
+	sched->activeTask = NULL;
+	sched->planes = NULL;
+	sched->planeWords = 0;
 
 	// Zero the average summing variable
 	sched->aperiodicResponseTimes = 0;
 	sched->aCount = plan->aCount;
+	sched->server = SERVER_NONE;
+	sched->serverBudget = sched->serverUsed = 0;
+	sched->states = NULL;
+
+	// Not counting unless MakeSchedule asks for the counters layout
+	sched->busyTicks = sched->missCount = sched->preemptCount = 0;
+	sched->lastRun.start = sched->lastRun.end = 0;
+	sched->lastRun.task = 0;
+	sched->statusTimes = NULL;
+	sched->statuses = NULL;
+	sched->stopAtMiss = sched->stopped = false;
+	sched->stoppedAt = 0;
 
 	// Auto-fill the headers based on the task ID's in the given plan
 	sched->header = (char**)malloc(sizeof(char*) * sched->tasks);
-	for (uint8_t pTask = 0; pTask < plan->pCount; ++pTask) {
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
 		PeriodicTask* task = plan->pTasks + pTask;
 		sched->header[task->taskIndex] = task->ID;
 	}
-	for (uint8_t aTask = 0; aTask < plan->aCount; ++aTask) {
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
 		AperiodicTask* task = plan->aTasks + aTask;
 		sched->header[task->taskIndex] = task->ID;
 	}
 
-	// Clear status state for all tasks at all times
-	uint32_t flag_n = sched->duration * sched->tasks;
-	sched->flags = (char*)malloc(sizeof(char) * flag_n);
-	for (uint32_t flag = 0; flag < flag_n; ++flag) {
-		sched->flags[flag] = STATUS_NONE;
-	}
+	return sched;
+}
 
-	// Release times are independent of schedule, so generate them up-front
-	for (uint8_t pTask = 0; pTask < plan->pCount; ++pTask) {
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - flags every release of the plan from the given time on                                                     |
+// The dense layout must be blank from then on, its periodic releases are set a word of the release plane at a time    |
+//---------------------------------------------------------------------------------------------------------------------+
+static void MarkReleases(Schedule* sched, SimPlan* plan, simtime_t from) {
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
 		PeriodicTask* task = plan->pTasks + pTask;
-		for (uint16_t release = 0; release < sched->duration; release += task->T) {
-			sched->flags[(release * plan->tasks) + task->taskIndex] = STATUS_RELEASED;
+		uint64_t first = ((uint64_t)from + task->T - 1) / task->T * task->T;
+		if (sched->planes != NULL) {
+			SetEvery(TaskPlanes(sched, task->taskIndex) + (PLANE_RELEASED * sched->planeWords), first, task->T,
+				sched->duration);
+			continue;
+		}
+		for (uint64_t release = first; release < sched->duration; release += task->T) {
+			SetStatus(sched, (simtime_t)release, task->taskIndex, STATUS_RELEASED);
 		}
 	}
-	for (uint8_t aTask = 0; aTask < plan->aCount; ++aTask) {
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
 		AperiodicTask* task = plan->aTasks + aTask;
-		sched->flags[(task->r * plan->tasks) + task->taskIndex] = STATUS_RELEASED;
+		if (task->r >= from && task->r < sched->duration) {
+			SetStatus(sched, task->r, task->taskIndex, STATUS_RELEASED);
+		}
 	}
+}
 
+//---------------------------------------------------------------------------------------------------------------------+
+// Dynamically allocates (must call CleanSchedule) space for a schedule with the right dimensions and a clean state    |
+// Also pre-fills the schedule with the released flag since it's convienient and independent of the type of schedule   |
+//---------------------------------------------------------------------------------------------------------------------+
+Schedule* MakeSchedule(SimPlan* plan) {
+	Schedule* sched = NewSchedule(plan);
+
+	// Create active task table (calloc initializes to 0 => slack)
+	if (plan->settings.layout == LAYOUT_DENSE) {
+		sched->activeTask = (taskid_t*)calloc(sizeof(taskid_t), sched->duration);
+	}
+
+	// Clear status state for all tasks at all times (calloc blanks every plane)
+	if (plan->settings.layout == LAYOUT_DENSE) {
+		sched->planeWords = ((size_t)sched->duration >> 6) + 1;
+		sched->planes = (uint64_t*)calloc(sizeof(uint64_t), (sched->planeWords * STATUS_PLANES * sched->tasks) + 1);
+	}
+
+	// The counters layout only remembers each task's latest status, and releases aren't counted so they aren't marked
+	if (plan->settings.layout == LAYOUT_COUNTERS) {
+		sched->statusTimes = (uint64_t*)calloc(sizeof(uint64_t), (size_t)sched->tasks + 1);
+		sched->statuses = (char*)calloc(sizeof(char), (size_t)sched->tasks + 1);
+		sched->stopAtMiss = plan->settings.stopAtMiss != 0;
+		return sched;
+	}
+
+	// Release times are independent of schedule, so generate them up-front
+	MarkReleases(sched, plan, 0);
+
+	return sched;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Like MakeSchedule, but holding what the previous schedule (in the same layout) has before `end`, for a simulation   |
+// which resumes from there. The plan may have more tasks than the previous schedule (an aperiodic task added after     |
+// the others), their cells before `end` are blank                                                                     |
+//---------------------------------------------------------------------------------------------------------------------+
+Schedule* ResumeSchedule(SimPlan* plan, Schedule* previous, simtime_t end) {
+	Schedule* sched = NewSchedule(plan);
+
+	if (previous->activeTask != NULL) {
+		sched->activeTask = (taskid_t*)malloc(sizeof(taskid_t) * ((size_t)sched->duration + 1));
+		memcpy(sched->activeTask, previous->activeTask, sizeof(taskid_t) * end);
+		memset(sched->activeTask + end, 0, sizeof(taskid_t) * (sched->duration - end));
+
+		// The planes of the tasks both schedules have keep their bits before `end`, everything else starts out blank
+		sched->planeWords = ((size_t)sched->duration >> 6) + 1;
+		sched->planes = (uint64_t*)calloc(sizeof(uint64_t), (sched->planeWords * STATUS_PLANES * sched->tasks) + 1);
+		taskid_t tasks = previous->tasks < sched->tasks ? previous->tasks : sched->tasks;
+		for (taskid_t task = 0; task < tasks; ++task) {
+			for (size_t plane = 0; plane < STATUS_PLANES; ++plane) {
+				CopyBits(TaskPlanes(sched, task) + (plane * sched->planeWords), 0,
+					TaskPlanes(previous, task) + (plane * previous->planeWords), 0, end);
+			}
+		}
+	}
+	else {
+		// Runs are in time order, the one running into `end` is cut there (the simulation extends it if it carries on)
+		size_t runs = 0;
+		while (runs < previous->runCount && previous->runs[runs].start < end) {
+			++runs;
+		}
+		sched->runs = (ScheduleRun*)malloc(sizeof(ScheduleRun) * (runs + 1));
+		memcpy(sched->runs, previous->runs, sizeof(ScheduleRun) * runs);
+		sched->runCount = runs;
+		sched->runCapacity = runs + 1;
+		if (runs > 0 && sched->runs[runs - 1].end > end) {
+			sched->runs[runs - 1].end = end;
+		}
+
+		// The previous events are finished, so the ones before `end` are already sorted with one per cell
+		size_t events = 0;
+		while (events < previous->eventCount && previous->events[events].time < end) {
+			++events;
+		}
+		sched->events = (ScheduleEvent*)malloc(sizeof(ScheduleEvent) * (events + 1));
+		memcpy(sched->events, previous->events, sizeof(ScheduleEvent) * events);
+		sched->eventCount = sched->sortedEvents = events;
+		sched->eventCapacity = events + 1;
+	}
+
+	MarkReleases(sched, plan, end);
 	return sched;
 }
 
@@ -261,6 +780,380 @@ Schedule* MakeSchedule(SimPlan* plan) {
 void CleanSchedule(Schedule* schedule) {
 	free(schedule->activeTask);
 	free(schedule->header);
-	free(schedule->flags);
+	free(schedule->planes);
+	free(schedule->runs);
+	free(schedule->events);
+	free(schedule->statusTimes);
+	free(schedule->statuses);
+	CleanSavedStates(schedule->states);
 	free(schedule);
 }
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Appropriately frees the memory associated with the given multiprocessor schedule and all of its lanes              |
+//---------------------------------------------------------------------------------------------------------------------+
+void CleanMultiSchedule(MultiSchedule* multi) {
+	for (uint16_t cpu = 0; cpu < multi->cpus; ++cpu) {
+		CleanSchedule(multi->lanes[cpu]);
+	}
+	free(multi->lanes);
+	free(multi->preemptions);
+	free(multi->migrations);
+	free(multi);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes the per-task bounds and the verdict of a schedulability analysis, times in microseconds of CPU               |
+//---------------------------------------------------------------------------------------------------------------------+
+void WriteAnalysis(FILE* fout, SimPlan* plan, Analysis* analysis) {
+	for (taskid_t rank = 0; rank < analysis->pCount; ++rank) {
+		taskid_t pTask = analysis->order[rank];
+		PeriodicTask* task = plan->pTasks + pTask;
+
+		fprintf(fout, "Task %s: ", task->ID);
+		if (analysis->fixedPriority) {
+			fprintf(fout, "priority %lu, ", (unsigned long)rank + 1);
+		}
+		fprintf(fout, "C = %llu us, D = %llu us, ",
+			(unsigned long long)task->C * TICK_MICROSECONDS,
+			(unsigned long long)task->T * TICK_MICROSECONDS);
+
+		if (analysis->meetsDeadline[pTask]) {
+			fprintf(fout, "response <= %llu us\r\n", (unsigned long long)analysis->response[pTask] * TICK_MICROSECONDS);
+		}
+		else if (analysis->response[pTask] > 0) {
+			fprintf(fout, "response >= %llu us > D\r\n", (unsigned long long)analysis->response[pTask] * TICK_MICROSECONDS);
+		}
+		else {
+			fprintf(fout, "no response bound\r\n");
+		}
+	}
+
+	fprintf(fout, "Utilization: %.4f\r\n", analysis->utilization);
+	if (analysis->busyPeriod > 0 || analysis->utilization <= 1.0) {
+		fprintf(fout, "Busy Period: %llu us\r\n", (unsigned long long)analysis->busyPeriod * TICK_MICROSECONDS);
+	}
+	else {
+		fprintf(fout, "Busy Period: unbounded\r\n");
+	}
+	if (analysis->firstMiss > 0) {
+		fprintf(fout, "Demand Exceeds Supply At: %llu us\r\n", (unsigned long long)analysis->firstMiss * TICK_MICROSECONDS);
+	}
+	fprintf(fout, "Schedulable: %s\r\n", analysis->schedulable ? "yes" : "no");
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Allocates an empty analysis of the periodic tasks of the given plan                                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+Analysis* MakeAnalysis(SimPlan* plan) {
+	Analysis* analysis = (Analysis*)calloc(1, sizeof(Analysis));
+	analysis->pCount = plan->pCount;
+	analysis->order = (taskid_t*)calloc(plan->pCount + 1, sizeof(taskid_t));
+	analysis->response = (uint64_t*)calloc(plan->pCount + 1, sizeof(uint64_t));
+	analysis->meetsDeadline = (bool*)calloc(plan->pCount + 1, sizeof(bool));
+
+	analysis->utilization = 0.0;
+	for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+		analysis->order[pTask] = pTask;
+		analysis->utilization += (double)plan->pTasks[pTask].C / plan->pTasks[pTask].T;
+	}
+
+	return analysis;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Appropriately frees the memory associated with the given analysis                                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+void CleanAnalysis(Analysis* analysis) {
+	free(analysis->order);
+	free(analysis->response);
+	free(analysis->meetsDeadline);
+	free(analysis);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Marks the given task (a column index, 0 => slack) as running over [start, end) in any layout                        |
+// In the compact and counters layouts runs must be emitted in time order, adjacent runs of the same task are merged   |
+//---------------------------------------------------------------------------------------------------------------------+
+void SetActive(Schedule* sched, simtime_t start, simtime_t end, taskid_t task) {
+	if (start >= end) {
+		return;
+	}
+
+	if (sched->statuses != NULL) {
+		if (task != 0 && task <= sched->tasks) {
+			sched->busyTicks += end - start;
+		}
+		if (sched->lastRun.task == task && sched->lastRun.end == start) {
+			sched->lastRun.end = end;
+		}
+		else {
+			sched->lastRun.start = start;
+			sched->lastRun.end = end;
+			sched->lastRun.task = task;
+		}
+		return;
+	}
+
+	if (sched->activeTask != NULL) {
+		for (simtime_t now = start; now < end; ++now) {
+			sched->activeTask[now] = task;
+		}
+		return;
+	}
+
+	// Slack is implied by the gaps between runs
+	if (task == 0) {
+		return;
+	}
+
+	if (sched->runCount > 0) {
+		ScheduleRun* last = sched->runs + (sched->runCount - 1);
+		if (last->task == task && last->end == start) {
+			last->end = end;
+			return;
+		}
+	}
+
+	if (sched->runCount == sched->runCapacity) {
+		sched->runCapacity = sched->runCapacity == 0 ? 64 : sched->runCapacity * 2;
+		sched->runs = (ScheduleRun*)realloc(sched->runs, sizeof(ScheduleRun) * sched->runCapacity);
+	}
+
+	ScheduleRun* run = sched->runs + (sched->runCount++);
+	run->start = start;
+	run->end = end;
+	run->task = task;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns the task (column index, 0 => slack) running at the given time in any layout                                 |
+// The counters layout only knows the latest run, which is as far back as the engines look                             |
+//---------------------------------------------------------------------------------------------------------------------+
+taskid_t GetActive(Schedule* sched, simtime_t now) {
+	if (sched->activeTask != NULL) {
+		return sched->activeTask[now];
+	}
+	if (sched->statuses != NULL) {
+		return sched->lastRun.start <= now && now < sched->lastRun.end ? sched->lastRun.task : 0;
+	}
+
+	// Binary search for the last run starting at or before now
+	size_t lo = 0, hi = sched->runCount;
+	while (lo < hi) {
+		size_t mid = lo + ((hi - lo) / 2);
+		if (sched->runs[mid].start <= now) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+
+	if (lo > 0 && sched->runs[lo - 1].end > now) {
+		return sched->runs[lo - 1].task;
+	}
+	return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Sets the status of a task at the given time in any layout, a later status for the same cell replaces the earlier    |
+// The counters layout relies on a cell only being rewritten while it holds its task's latest status                   |
+//---------------------------------------------------------------------------------------------------------------------+
+void SetStatus(Schedule* sched, simtime_t now, taskid_t taskIndex, char status) {
+	if (sched->planes != NULL) {
+		// Only the plane of the new status keeps the cell's bit
+		uint64_t* planes = TaskPlanes(sched, taskIndex) + (now >> 6);
+		uint64_t bit = 1ull << (now & 63);
+		for (size_t plane = 0; plane < STATUS_PLANES; ++plane) {
+			if (planeStatus[plane] == status) {
+				planes[plane * sched->planeWords] |= bit;
+			}
+			else {
+				planes[plane * sched->planeWords] &= ~bit;
+			}
+		}
+		return;
+	}
+
+	if (sched->statuses != NULL) {
+		if (sched->statusTimes[taskIndex] == (uint64_t)now + 1) {
+			sched->missCount -= sched->statuses[taskIndex] == STATUS_OVERDUE;
+			sched->preemptCount -= sched->statuses[taskIndex] == STATUS_PREEMPTED;
+		}
+		sched->statusTimes[taskIndex] = (uint64_t)now + 1;
+		sched->statuses[taskIndex] = status;
+		sched->missCount += status == STATUS_OVERDUE;
+		sched->preemptCount += status == STATUS_PREEMPTED;
+
+		if (status == STATUS_OVERDUE && sched->stopAtMiss && !sched->stopped) {
+			sched->stopped = true;
+			sched->stoppedAt = now;
+		}
+		return;
+	}
+
+	if (sched->eventCount == sched->eventCapacity) {
+		sched->eventCapacity = sched->eventCapacity == 0 ? 64 : sched->eventCapacity * 2;
+		sched->events = (ScheduleEvent*)realloc(sched->events, sizeof(ScheduleEvent) * sched->eventCapacity);
+	}
+
+	ScheduleEvent* event = sched->events + (sched->eventCount++);
+	event->time = now;
+	event->taskIndex = taskIndex;
+	event->status = status;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns the status of a task at the given time in the dense layout (STATUS_NONE => blank)                           |
+//---------------------------------------------------------------------------------------------------------------------+
+char GetStatus(Schedule* sched, simtime_t now, taskid_t taskIndex) {
+	uint64_t* planes = TaskPlanes(sched, taskIndex) + (now >> 6);
+	for (size_t plane = 0; plane < STATUS_PLANES; ++plane) {
+		if ((planes[plane * sched->planeWords] >> (now & 63)) & 1) {
+			return planeStatus[plane];
+		}
+	}
+	return STATUS_NONE;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Copies everything recorded in [start, start + period) over [start + period, end), replacing what is there           |
+// For simulations which have proven their schedule repeats with the given period from start on                        |
+// Only the statuses of task indices below `tasks` are copied, the others keep their own (e.g. aperiodic releases)     |
+// In the compact layout nothing may have been emitted at or after start + period except release events                |
+//---------------------------------------------------------------------------------------------------------------------+
+void RepeatSchedule(Schedule* sched, simtime_t start, simtime_t period, simtime_t end, taskid_t tasks) {
+	if (sched->activeTask != NULL) {
+		for (simtime_t from = start + period; from < end; from += period) {
+			simtime_t n = end - from < period ? end - from : period;
+			memcpy(sched->activeTask + from, sched->activeTask + start, sizeof(taskid_t) * n);
+
+			// The copy never overlaps the pattern, which ends at start + period
+			for (taskid_t task = 0; task < tasks; ++task) {
+				for (size_t plane = 0; plane < STATUS_PLANES; ++plane) {
+					uint64_t* bits = TaskPlanes(sched, task) + (plane * sched->planeWords);
+					CopyBits(bits, from, bits, start, n);
+				}
+			}
+		}
+		return;
+	}
+
+	// Runs are in time order, so the pattern is a contiguous slice (clipped at both ends)
+	size_t firstRun = 0, lastRun = sched->runCount;
+	while (firstRun < lastRun && sched->runs[firstRun].end <= start) {
+		++firstRun;
+	}
+	while (lastRun > firstRun && sched->runs[lastRun - 1].start >= start + period) {
+		--lastRun;
+	}
+
+	// Events are still in emission order, which is kept for each copy so later statuses still win
+	size_t patternCount = 0;
+	ScheduleEvent* pattern = (ScheduleEvent*)malloc(sizeof(ScheduleEvent) * (sched->eventCount + 1));
+	for (size_t event = 0; event < sched->eventCount; ++event) {
+		ScheduleEvent* copy = sched->events + event;
+		if (copy->taskIndex < tasks && copy->time >= start && copy->time < start + period) {
+			pattern[patternCount++] = *copy;
+		}
+	}
+
+	for (simtime_t from = start + period; from < end; from += period) {
+		simtime_t shift = from - start;
+
+		for (size_t run = firstRun; run < lastRun; ++run) {
+			simtime_t runStart = sched->runs[run].start < start ? start : sched->runs[run].start;
+			simtime_t runEnd = sched->runs[run].end > start + period ? start + period : sched->runs[run].end;
+			if (runEnd + shift > end) {
+				runEnd = end - shift;
+			}
+			SetActive(sched, runStart + shift, runEnd + shift, sched->runs[run].task);
+		}
+
+		for (size_t event = 0; event < patternCount; ++event) {
+			if (pattern[event].time + shift < end) {
+				SetStatus(sched, pattern[event].time + shift, pattern[event].taskIndex, pattern[event].status);
+			}
+		}
+	}
+	free(pattern);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - true when event a belongs to an earlier cell of the schedule table than event b                            |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline bool EventBefore(ScheduleEvent* a, ScheduleEvent* b) {
+	return a->time < b->time || (a->time == b->time && a->taskIndex < b->taskIndex);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - stable bottom-up merge sort of n events, ping-ponging between them and a scratch array of the same size    |
+// Returns whichever of the two holds the sorted events                                                                |
+//---------------------------------------------------------------------------------------------------------------------+
+static ScheduleEvent* SortEvents(ScheduleEvent* src, ScheduleEvent* dst, size_t n) {
+	for (size_t width = 1; width < n; width *= 2) {
+		for (size_t lo = 0; lo < n; lo += 2 * width) {
+			size_t mid = lo + width < n ? lo + width : n;
+			size_t hi = mid + width < n ? mid + width : n;
+			size_t i = lo, j = mid, k = lo;
+			while (i < mid && j < hi) {
+				dst[k++] = EventBefore(src + j, src + i) ? src[j++] : src[i++];
+			}
+			while (i < mid) { dst[k++] = src[i++]; }
+			while (j < hi) { dst[k++] = src[j++]; }
+		}
+		ScheduleEvent* temp = src;
+		src = dst;
+		dst = temp;
+	}
+	return src;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Puts the compact layout in rendering order once a simulation is done (no-op for the dense layout)                   |
+// Events are merge sorted (stable, so emission order holds within a cell) and only the last status of a cell is kept  |
+// Leading events which are already finished (see ResumeSchedule) are only merged with the sorted rest                 |
+//---------------------------------------------------------------------------------------------------------------------+
+void FinishSchedule(Schedule* sched) {
+	size_t n = sched->eventCount;
+	if (sched->planes != NULL || n < 2) {
+		return;
+	}
+
+	size_t sorted = sched->sortedEvents < n ? sched->sortedEvents : n;
+	size_t m = n - sorted;
+	ScheduleEvent* src = sched->events;
+	if (sorted == 0) {
+		ScheduleEvent* dst = (ScheduleEvent*)malloc(sizeof(ScheduleEvent) * n);
+		src = SortEvents(src, dst, n);
+		free(src == dst ? sched->events : dst);
+	}
+	else if (m > 0) {
+		ScheduleEvent* scratch = (ScheduleEvent*)malloc(sizeof(ScheduleEvent) * m);
+		ScheduleEvent* tail = SortEvents(sched->events + sorted, scratch, m);
+
+		// Ties go to the tail, which was emitted later
+		src = (ScheduleEvent*)malloc(sizeof(ScheduleEvent) * n);
+		size_t i = 0, j = 0, k = 0;
+		while (i < sorted && j < m) {
+			src[k++] = EventBefore(tail + j, sched->events + i) ? tail[j++] : sched->events[i++];
+		}
+		while (i < sorted) { src[k++] = sched->events[i++]; }
+		while (j < m) { src[k++] = tail[j++]; }
+		free(scratch);
+		free(sched->events);
+	}
+	sched->events = src;
+	sched->eventCapacity = n;
+
+	// Collapse repeated cells to the last status written
+	size_t kept = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (kept > 0 && !EventBefore(src + (kept - 1), src + i)) {
+			--kept;
+		}
+		src[kept++] = src[i];
+	}
+	sched->eventCount = sched->sortedEvents = kept;
+}
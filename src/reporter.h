@@ -1,4 +1,6 @@
 #pragma once
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -10,22 +12,182 @@ enum
 	STATUS_OVERDUE      = 'd',
 };
 
+// The dense layout's bitplanes, one per status other than STATUS_NONE
+enum
+{
+	PLANE_RELEASED      = 0,
+	PLANE_PREEMPTED     = 1,
+	PLANE_OVERDUE       = 2,
+	STATUS_PLANES       = 3,
+};
+
+// A span of time [start, end) during which a single task is executing
 typedef struct {
-	uint16_t duration;
-	uint8_t tasks;
+	simtime_t start;
+	simtime_t end;
+	taskid_t task; // same values as activeTask
+} ScheduleRun;
+
+// A single non-blank status of a task at some time
+typedef struct {
+	simtime_t time;
+	taskid_t taskIndex;
+	char status;
+} ScheduleEvent;
+
+typedef struct {
+	simtime_t duration;
+	taskid_t tasks;
 	char** header;
 	
 	// array of length `duration` values in [0, tasks] (0 => slack)
-	uint8_t* activeTask;
+	taskid_t* activeTask;
+
+	// flattened array of dimensions [tasks][STATUS_PLANES][planeWords], one bit per tick in each plane
+	// A task's status at a tick is that of the plane with its bit set, STATUS_NONE when no plane has it
+	uint64_t* planes;
+	size_t planeWords;
 
-	// flattened array of dimensions [duration][tasks]
-	char* flags;
+	// Compact layout (activeTask and planes are NULL): runs in time order with no slack runs
+	// and events sorted by time then task once the simulation is finished
+	ScheduleRun* runs;
+	size_t runCount;
+	size_t runCapacity;
+	ScheduleEvent* events;
+	size_t eventCount;
+	size_t eventCapacity;
+	size_t sortedEvents; // leading events already in finished order, FinishSchedule only has to sort the rest
 
 	// sum of response times of each aperiodic task (division by aCount done by the reporter)
-	uint16_t aperiodicResponseTimes;
-	uint8_t aCount;
+	uint64_t aperiodicResponseTimes;
+	taskid_t aCount;
+
+	// the aperiodic server the engine ran (SERVER_NONE => none), its nominal capacity over the
+	// duration (see ServerCapacity) and the ticks it ran aperiodic jobs
+	uint8_t server;
+	uint64_t serverBudget;
+	uint64_t serverUsed;
+
+	// Counters layout only (activeTask, planes, runs and events stay NULL): what the summary counts, the latest run
+	// and each task's latest status by task index (time + 1, 0 => none) so a later status for the same cell replaces it
+	uint64_t busyTicks;
+	uint64_t missCount;
+	uint64_t preemptCount;
+	ScheduleRun lastRun;
+	uint64_t* statusTimes;
+	char* statuses;
+	bool stopAtMiss;
+	bool stopped; // a status of STATUS_OVERDUE was set with stopAtMiss, the engine stops at the next decision point
+	simtime_t stoppedAt;
+
+	// EDF only: the engine's state saved along the way when the plan is resumable (NULL otherwise, see edfsched.c)
+	struct SavedStates* states;
 } Schedule;
 
-void WriteSchedule(FILE* fout, Schedule* schedule);
+// One plan simulated on several processors at once: a lane per CPU with what ran there, and what each task went through
+typedef struct {
+	uint16_t cpus;
+	Schedule** lanes; // each lane's aCount is 0, aperiodic response times are kept for the whole run below
+
+	// per task index: times a job was preempted, and times one resumed on another CPU than the one it last ran on
+	uint64_t* preemptions;
+	uint64_t* migrations;
+
+	uint64_t aperiodicResponseTimes;
+} MultiSchedule;
+
+// The statistics printed below each schedule table
+typedef struct {
+	float utilization;
+	uint64_t missedDeadlines;
+	uint64_t preemptions;
+	float aperiodicResponse; // average, NaN without aperiodic tasks
+} ScheduleSummary;
+
+// Result of an analytical schedulability test over the periodic tasks (aperiodic tasks are soft and not analyzed)
+typedef struct {
+	taskid_t pCount;
+
+	// indices into pTasks from highest to lowest priority (plan order when priority is dynamic)
+	taskid_t* order;
+
+	// per pTask: upper bound on the worst-case response time in ticks when meetsDeadline,
+	// otherwise a lower bound past the deadline (0 => no bound is known)
+	uint64_t* response;
+	bool* meetsDeadline;
+
+	bool fixedPriority;
+	bool schedulable;
+	double utilization;
+
+	// length of the synchronous busy period in ticks (0 with utilization above 1 => unbounded, the processor is overloaded)
+	uint64_t busyPeriod;
+	// first time at which demand exceeds the supplied time within the plan's duration (0 => none found)
+	uint64_t firstMiss;
+} Analysis;
+
+// Work done by an engine, counted per thread while it simulates
+// Only kept when built with -DSIM_STATS (make STATS=1), otherwise COUNT expands to nothing and the engines pay nothing
+typedef struct {
+	uint64_t ticks; // ticks of the timeline simulated (not copied over from an earlier hyperperiod)
+	uint64_t jobsReleased;
+	uint64_t queueOps; // pushes, pops and sifts of the ready and release queues
+	uint64_t preemptions;
+	uint64_t scanSteps; // lookups and hops through the free slot index during ALAP placement
+} SimCounters;
+
+#ifdef SIM_STATS
+extern _Thread_local SimCounters simCounters;
+#define COUNT(counter, n) (simCounters.counter += (n))
+#else
+#define COUNT(counter, n) ((void)0)
+#endif
+
+// Wall-clock and CPU seconds spent in one phase of a run, accumulated over every Start/StopPhase pair
+typedef struct {
+	double wall;
+	double cpu;
+} PhaseTimer;
+
+// What --stats reports about a run
+typedef struct {
+	PhaseTimer parse;
+	PhaseTimer rmSimulation;
+	PhaseTimer edfSimulation;
+	PhaseTimer asapSimulation; // only with --asap
+	PhaseTimer report; // tables or traces of both schedules
+	PhaseTimer analysis;
+	SimCounters rm;
+	SimCounters edf;
+	SimCounters asap;
+} SimStats;
+
+ScheduleSummary WriteSchedule(FILE* fout, Schedule* schedule);
+ScheduleSummary WriteScheduleParallel(FILE* fout, Schedule* schedule, unsigned threads);
+ScheduleSummary SummarizeSchedule(Schedule* schedule);
+void WriteSummary(FILE* fout, ScheduleSummary* summary);
+void WriteServerUsage(FILE* fout, Schedule* sched, const char* scheduler, uint8_t format);
 Schedule* MakeSchedule(SimPlan* plan);
+Schedule* ResumeSchedule(SimPlan* plan, Schedule* previous, simtime_t end);
 void CleanSchedule(Schedule* schedule);
+void CleanMultiSchedule(MultiSchedule* multi);
+
+void WriteTraceHeader(FILE* fout, uint8_t format);
+ScheduleSummary WriteTrace(FILE* fout, SimPlan* plan, Schedule* schedule, const char* scheduler, uint8_t format);
+
+void StartPhase(PhaseTimer* timer);
+void StopPhase(PhaseTimer* timer);
+void ResetCounters(void);
+SimCounters TakeCounters(void);
+void WriteStats(FILE* fout, SimStats* stats);
+
+void WriteAnalysis(FILE* fout, SimPlan* plan, Analysis* analysis);
+Analysis* MakeAnalysis(SimPlan* plan);
+void CleanAnalysis(Analysis* analysis);
+
+void SetActive(Schedule* schedule, simtime_t start, simtime_t end, taskid_t task);
+taskid_t GetActive(Schedule* schedule, simtime_t now);
+void SetStatus(Schedule* schedule, simtime_t now, taskid_t taskIndex, char status);
+char GetStatus(Schedule* schedule, simtime_t now, taskid_t taskIndex);
+void RepeatSchedule(Schedule* schedule, simtime_t start, simtime_t period, simtime_t end, taskid_t tasks);
+void FinishSchedule(Schedule* schedule);
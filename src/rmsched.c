@@ -2,6 +2,7 @@
 #include "reporter.h"
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 //---------------------------------------------------------------------------------------------------------------------+
 // Helper function - sorts a list of tasks such that higher proirity is lower indexed in the given list                |
@@ -9,9 +10,9 @@
 // For periodic tasks in rate monotonic scheduling, the shorter period has the higher priority                         |
 // Exploits symmetry of (AperiodicTask*)->r to achieve earliest release priority for aperiodic tasks                   |
 //---------------------------------------------------------------------------------------------------------------------+
-static inline void sortTasks(PeriodicTask** tasks, uint8_t pCount) {
-	for (uint8_t i = 0; i < pCount; i++) {
-		for (uint8_t j = i + 1; j < pCount; j++) {
+static inline void sortTasks(PeriodicTask** tasks, taskid_t pCount) {
+	for (taskid_t i = 0; i < pCount; i++) {
+		for (taskid_t j = i + 1; j < pCount; j++) {
 			if (tasks[j]->T < tasks[i]->T) {
 				PeriodicTask* temp = tasks[i];
 				tasks[i] = tasks[j];
@@ -26,22 +27,50 @@ static inline void sortTasks(PeriodicTask** tasks, uint8_t pCount) {
 	}
 }
 
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - finds the root of x in a union-find slot index (with path halving)                                         |
+// Occupied slots link towards the next slot worth checking, so the root is the nearest free slot in that direction    |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline simtime_t FindSlot(simtime_t* slots, simtime_t x) {
+	COUNT(scanSteps, 1);
+	while (slots[x] != x) {
+		slots[x] = slots[slots[x]];
+		x = slots[x];
+		COUNT(scanSteps, 1);
+	}
+	return x;
+}
+
 //---------------------------------------------------------------------------------------------------------------------+
 // Generates a schedule for rate monotonic where periodic tasks are scheduled ALAP                                     |
 //---------------------------------------------------------------------------------------------------------------------+
 Schedule* RmSimulation(SimPlan* plan) {
 	Schedule* sched = MakeSchedule(plan);
 
+	// ALAP placement needs random access to the whole timeline, the compact layout is built from it afterwards
+	taskid_t* activeTask = sched->activeTask;
+	if (activeTask == NULL) {
+		activeTask = (taskid_t*)calloc(sizeof(taskid_t), plan->duration);
+	}
+
 	bool preemptFlag = false;
 
-	uint8_t task; // index of pTask or aTask marking the active task
+	taskid_t task; // index of pTask or aTask marking the active task
 
-	uint16_t
+	simtime_t
 		now, // marker for the current time while iterating
 		runtime, // the amount of time left to schedule for the current task
 		release, // the time at which the current task was released
 		deadline; // the time at which the current task will have missed its deadline
 
+	// Index of free slots so placement skips over what is already scheduled instead of re-walking it
+	// ALAP placement searches backwards: slots[t + 1] leads to 1 + the latest free slot at or before t (0 => none)
+	// Aperiodic slack filling searches forwards: slots[t] leads to the earliest free slot at or after t (duration => none)
+	simtime_t* slots = (simtime_t*)malloc(sizeof(simtime_t) * ((size_t)plan->duration + 1));
+	for (size_t slot = 0; slot <= plan->duration; ++slot) {
+		slots[slot] = slot;
+	}
+
 	// Generate a list of periodic tasks sorted by shortest period first
 	PeriodicTask** pTasks = (PeriodicTask**)calloc(sizeof(PeriodicTask*), plan->pCount);
 	for (task = 0; task < plan->pCount; task++) {
@@ -49,71 +78,106 @@ Schedule* RmSimulation(SimPlan* plan) {
 	}
 	sortTasks(pTasks, plan->pCount);
 
+	// Each ALAP job only lands inside its own period, so the periodic part of the schedule repeats every hyperperiod
+	// When extrapolating, only the first hyperperiod and the tail past the last whole one are placed job by job
+	// (not in the counters layout, which keeps no hyperperiod to copy)
+	simtime_t hyperperiod = plan->settings.extrapolate && plan->settings.layout != LAYOUT_COUNTERS ?
+		PlanHyperperiod(plan) : 0;
+	simtime_t repeatEnd = hyperperiod != 0 ? (plan->duration / hyperperiod) * hyperperiod : 0;
+	if (repeatEnd <= hyperperiod) {
+		hyperperiod = repeatEnd = 0;
+	}
+
 	// Generate the schedule ALAP in order of the highest priority periodic tasks
-	for (task = 0; task < plan->pCount; task++) {
+	// A simulation which stops at its first miss stops placing once one is found
+	for (task = 0; task < plan->pCount && !sched->stopped; task++) {
 		bool incompletePeriod = false;
 		deadline = release = 0;
 
 		// Schedule all periods for the given task with whatever space is left in the schdule
 		// (Current task is the higest priority among unscheduled tasks)
-		while (deadline < plan->duration) {
-			uint16_t finalPreempt = 0;
+		while (deadline < plan->duration && !sched->stopped) {
+			simtime_t finalPreempt = 0;
 			runtime = pTasks[task]->C;
-			preemptFlag = false;
+			COUNT(jobsReleased, 1);
 
 			// Increment at the start of the loop to catch an incomplete period
-			deadline += pTasks[task]->T;
-			if (deadline > plan->duration) {
+			// (compared before adding, deadline + T can overflow simtime_t when the duration is close to its limit)
+			if (pTasks[task]->T > plan->duration - deadline) {
 				deadline = plan->duration;
 				incompletePeriod = true;
 			}
+			else {
+				deadline += pTasks[task]->T;
+			}
 
-			// Iterate backwards in time so it is scheduled as late as possible
-			for (now = deadline - 1; runtime > 0; now--) {
-				if (sched->activeTask[now] == 0) {
-					// If not yet scheduled, it is the time at which we are preempted before missing a deadline
-					if (finalPreempt == 0) {
-						finalPreempt = now;
-					}
-
-					// If the next task in the schedule is different we are about to be preempted
-					if (preemptFlag) {
-						sched->flags[(now * sched->tasks) + pTasks[task]->taskIndex] = STATUS_PREEMPTED;
-					}
-
-					// Signal to the next loop (now - 1) that at this point (now) the current task was running
-					preemptFlag = false;
-
-					// Schedule the current job for the given cycle
-					sched->activeTask[now] = pTasks[task]->columnIndex;
-					runtime--;
-				}
+			// Jump backwards in time from free slot to free slot so it is scheduled as late as possible
+			simtime_t placed = deadline; // the slot filled last (deadline before any)
+			while (runtime > 0) {
+				simtime_t slot = FindSlot(slots, placed);
 
-				// If we have executed but not not at the current now signal preemption to the next loop (now - 1)
-				else if (runtime != pTasks[task]->C) {
-					preemptFlag = true;
-				}
-
-				// If we've iterated back to the release time then this task was unable to meet it's deadline
-				if (release == now && runtime != 0) {
+				// If there is no free slot left since the release time this task was unable to meet it's deadline
+				if (slot == 0 || slot - 1 < release) {
 					// Or the deadline is past the simulation's end point and we don't know
 					if (!incompletePeriod) {
 						// The last time this task is scheduled for is the time when it's preempted
-						sched->flags[(finalPreempt * sched->tasks) + pTasks[task]->taskIndex] = STATUS_PREEMPTED;
+						// (a job which never ran was never preempted, and finalPreempt would point at time 0)
+						if (runtime != pTasks[task]->C) {
+							SetStatus(sched, finalPreempt, pTasks[task]->taskIndex, STATUS_PREEMPTED);
+							COUNT(preemptions, 1);
+						}
 
 						// May overwrite the previous status if we were able to schedule at the deadline and that's ok
-						sched->flags[((deadline - 1) * sched->tasks) + pTasks[task]->taskIndex] = STATUS_OVERDUE;
+						SetStatus(sched, deadline - 1, pTasks[task]->taskIndex, STATUS_OVERDUE);
 					}
 					break;
 				}
+				now = slot - 1;
+
+				// If not yet scheduled, it is the time at which we are preempted before missing a deadline
+				if (runtime == pTasks[task]->C) {
+					finalPreempt = now;
+				}
+
+				// If we have executed but something else runs between now and the slot filled last we are about to be preempted
+				else if (now + 1 != placed) {
+					SetStatus(sched, now, pTasks[task]->taskIndex, STATUS_PREEMPTED);
+					COUNT(preemptions, 1);
+				}
+
+				// Schedule the current job for the given cycle and link the slot to the one before it
+				activeTask[now] = pTasks[task]->columnIndex;
+				slots[now + 1] = now;
+				placed = now;
+				runtime--;
 			}
 
 			// The release time of the (n+1)'th period of the given task is the deadline of the n'th period
 			release = deadline;
+
+			// Skip the hyperperiods which are copied from the first one
+			if (deadline == hyperperiod) {
+				deadline = release = repeatEnd;
+			}
 		}
 	}
 	free(pTasks);
 
+	if (hyperperiod != 0) {
+		RepeatSchedule(sched, 0, hyperperiod, repeatEnd, plan->pCount);
+		if (activeTask != sched->activeTask) {
+			for (now = hyperperiod; now < repeatEnd; now += hyperperiod) {
+				memcpy(activeTask + now, activeTask, sizeof(taskid_t) * hyperperiod);
+			}
+		}
+	}
+
+	// Rebuild the slot index for forward searches over what the periodic tasks left
+	for (now = 0; now < plan->duration; ++now) {
+		slots[now] = activeTask[now] == 0 ? now : now + 1;
+	}
+	slots[plan->duration] = plan->duration;
+
 	// Generate a list of aperiodic tasks sorted by earliest release time first
 	AperiodicTask** aTasks = (AperiodicTask**)calloc(sizeof(AperiodicTask*), plan->aCount);
 	for (task = 0; task < plan->aCount; task++) {
@@ -121,23 +185,27 @@ Schedule* RmSimulation(SimPlan* plan) {
 	}
 	sortTasks((PeriodicTask**)aTasks, plan->aCount);
 
-	// Proc the first aperiodic task
+	// Proc the first aperiodic task (if there is one)
 	task = 0;
 	preemptFlag = false;
-	runtime = aTasks[task]->C;
-	release = aTasks[task]->r;
-	deadline = release + APERIODIC_DEADLINE;
+	runtime = release = deadline = 0;
+	if (plan->aCount > 0) {
+		runtime = aTasks[task]->C;
+		release = aTasks[task]->r;
+		deadline = release + APERIODIC_DEADLINE;
+	}
 
 	// No need to loop over time before the first aperiodic tasks is released
 	now = release;
 
 	// Aperiodic tasks don't switch as often as periodic tasks: aTasks[i + 1] does not execute until aTasks[i] is done
 	// Exploit this fact to loop over time and aTasks in the same loop
-	while (now < plan->duration && task < plan->aCount) {
+	while (now < plan->duration && task < plan->aCount && !sched->stopped) {
 
 		// Only schedule where there is slack
-		if (sched->activeTask[now] == 0) {
-			sched->activeTask[now] = aTasks[task]->columnIndex;
+		if (activeTask[now] == 0) {
+			activeTask[now] = aTasks[task]->columnIndex;
+			slots[now] = now + 1;
 			runtime--;
 
 			// Signal to the next cycle that we ran this cycle
@@ -160,21 +228,28 @@ Schedule* RmSimulation(SimPlan* plan) {
 					continue;
 				}
 			}
+
+			// The iterator through time which we avoid using as much as possible
+			now++;
 		}
 
 		// If there is not slack in this cycle, and we ran the last cycle, we were preempted in that cycle
-		else if (preemptFlag) {
-			sched->flags[((now - 1) * sched->tasks) + aTasks[task]->taskIndex] = STATUS_PREEMPTED;
-			preemptFlag = false;
-		}
+		else {
+			if (preemptFlag) {
+				SetStatus(sched, now - 1, aTasks[task]->taskIndex, STATUS_PREEMPTED);
+				COUNT(preemptions, 1);
+				preemptFlag = false;
+			}
 
-		// The iterator through time which we avoid using as much as possible
-		now++;
+			// Skip the busy stretch up to the next slack, stopping early at the deadline to record the miss below
+			simtime_t slot = FindSlot(slots, now);
+			now = deadline < slot ? deadline : slot;
+		}
 
 		// Loop in order to handle multiple aperiodic tasks having the same deadline
 		while (deadline == now) {
 			// Our standard (because of periodic tasks) is to mark the missed deadline at deadline - 1
-			sched->flags[((now - 1) * sched->tasks) + aTasks[task]->taskIndex] = STATUS_OVERDUE;
+			SetStatus(sched, now - 1, aTasks[task]->taskIndex, STATUS_OVERDUE);
 
 			// record the response time of this task
 			sched->aperiodicResponseTimes += now - release;
@@ -193,6 +268,515 @@ Schedule* RmSimulation(SimPlan* plan) {
 		}
 	}
 	free(aTasks);
+	free(slots);
+	COUNT(jobsReleased, plan->aCount);
+	COUNT(ticks, plan->duration - (hyperperiod != 0 ? repeatEnd - hyperperiod : 0));
+
+	// Emit the timeline as runs when it was only a working copy
+	if (activeTask != sched->activeTask) {
+		simtime_t start = 0;
+		for (uint64_t time = 1; time <= plan->duration; time++) {
+			if (time == plan->duration || activeTask[time] != activeTask[start]) {
+				SetActive(sched, start, time, activeTask[start]);
+				start = time;
+			}
+		}
+		free(activeTask);
+	}
+
+	FinishSchedule(sched);
+	return sched;
+}
+
+// A job of a forward fixed priority simulation, each task has at most one in flight so it has its own
+typedef struct FpJob {
+	PeriodicTask* genericTask;
+	bool aperiodic;
+	bool inFlight;
+	simtime_t runtime;
+	simtime_t release;
+	uint64_t deadline; // can lie past the end of simtime_t when the horizon is near its limit
+	taskid_t level;
+	struct FpJob* next; // next job of the same level, in the order they run
+} FpJob;
+
+// Ready jobs of a forward fixed priority simulation: a FIFO per priority level (0 is the highest) and a bitmap of the
+// levels holding any, with a summary bit per word of the bitmap so the highest ready level is two count-trailing-zeros
+// away for up to 4096 levels
+typedef struct {
+	FpJob** heads;
+	FpJob** tails;
+	uint64_t* words;
+	uint64_t* summary;
+	size_t summaryCount;
+} ReadyLevels;
+
+// ReadyLevels has no level ready
+#define NO_LEVEL SIZE_MAX
+
+// A budget the sporadic server gets back at a later time
+typedef struct {
+	uint64_t time;
+	simtime_t amount;
+} FpRefill;
+
+// The server the aperiodic level runs under, kind SERVER_NONE when aperiodic jobs simply run whenever it's their turn
+typedef struct {
+	uint8_t kind;
+	simtime_t budget;
+	simtime_t period;
+	simtime_t capacity; // budget left to run aperiodic jobs with
+	uint64_t nextPeriod; // polling and deferrable only: the next k * Ts the budget is reset at
+
+	// Sporadic only: whether the server is ready (jobs pending and capacity left) since activeSince, what it has used
+	// since then, and the budgets it gets back in time order from refillHead on
+	bool active;
+	uint64_t activeSince;
+	simtime_t consumed;
+	FpRefill* refills;
+	size_t refillHead;
+	size_t refillCount;
+	size_t refillCapacity;
+
+	uint64_t used;
+} FpServer;
+
+// The next release of a periodic task, by its rank in priority order
+typedef struct {
+	uint64_t time;
+	taskid_t rank;
+} FpRelease;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - sets or clears a level's bit (and its word's summary bit), whether or not the level holds any jobs         |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void MarkLevel(ReadyLevels* ready, taskid_t level, bool isReady) {
+	if (isReady) {
+		ready->words[level >> 6] |= 1ull << (level & 63);
+		ready->summary[level >> 12] |= 1ull << ((level >> 6) & 63);
+	}
+	else {
+		ready->words[level >> 6] &= ~(1ull << (level & 63));
+		if (ready->words[level >> 6] == 0) {
+			ready->summary[level >> 12] &= ~(1ull << ((level >> 6) & 63));
+		}
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - appends a job to its level's FIFO, marking the level ready                                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void PushLevel(ReadyLevels* ready, FpJob* job) {
+	COUNT(queueOps, 1);
+	taskid_t level = job->level;
+	job->next = NULL;
+	if (ready->heads[level] == NULL) {
+		ready->heads[level] = job;
+		MarkLevel(ready, level, true);
+	}
+	else {
+		ready->tails[level]->next = job;
+	}
+	ready->tails[level] = job;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - removes the job at the head of the given level's FIFO, clearing the level once it's empty                  |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void PopLevel(ReadyLevels* ready, taskid_t level) {
+	COUNT(queueOps, 1);
+	ready->heads[level] = ready->heads[level]->next;
+	if (ready->heads[level] == NULL) {
+		MarkLevel(ready, level, false);
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - the highest ready level (NO_LEVEL when nothing is ready)                                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline size_t FirstLevel(ReadyLevels* ready) {
+	for (size_t s = 0; s < ready->summaryCount; ++s) {
+		if (ready->summary[s] != 0) {
+			size_t word = (s << 6) + (size_t)__builtin_ctzll(ready->summary[s]);
+			return (word << 6) + (size_t)__builtin_ctzll(ready->words[word]);
+		}
+	}
+	return NO_LEVEL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - moves the release at the given heap position down to its place, keyed on (time, rank)                      |
+//---------------------------------------------------------------------------------------------------------------------+
+static void SiftFpRelease(FpRelease* releases, size_t count, size_t i) {
+	COUNT(queueOps, 1);
+	FpRelease moved = releases[i];
+	for (;;) {
+		size_t child = (2 * i) + 1;
+		if (child >= count) {
+			break;
+		}
+		if (child + 1 < count && (releases[child + 1].time < releases[child].time ||
+			(releases[child + 1].time == releases[child].time && releases[child + 1].rank < releases[child].rank))) {
+			++child;
+		}
+		if (releases[child].time > moved.time || (releases[child].time == moved.time && releases[child].rank > moved.rank)) {
+			break;
+		}
+		releases[i] = releases[child];
+		i = child;
+	}
+	releases[i] = moved;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - closes a job which reached its deadline unfinished, marking the miss on the tick before the deadline       |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void MissFpJob(Schedule* sched, ReadyLevels* ready, FpJob* job) {
+	simtime_t last = (simtime_t)(job->deadline - 1);
+	SetStatus(sched, last, job->genericTask->taskIndex, STATUS_OVERDUE);
+	if (job->aperiodic) {
+		sched->aperiodicResponseTimes += last - job->release;
+	}
+	PopLevel(ready, job->level);
+	job->inFlight = false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - sets up the plan's server when it is one the fixed priority engine runs (polling, deferrable or sporadic)  |
+//---------------------------------------------------------------------------------------------------------------------+
+static FpServer MakeFpServer(SimPlan* plan) {
+	FpServer server;
+	memset(&server, 0, sizeof(FpServer));
+	if (plan->server.kind == SERVER_POLLING || plan->server.kind == SERVER_DEFERRABLE ||
+		plan->server.kind == SERVER_SPORADIC) {
+		server.kind = plan->server.kind;
+		server.budget = plan->server.budget;
+		server.period = plan->server.period;
+	}
+
+	// The sporadic server starts with its full budget, the others get it at their first period (at 0)
+	if (server.kind == SERVER_SPORADIC) {
+		server.capacity = server.budget;
+	}
+	return server;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - brings the server up to date at a decision point: hands out the budget due by now, then marks the          |
+// aperiodic level ready only while it has both jobs pending and budget left to run them                               |
+//---------------------------------------------------------------------------------------------------------------------+
+static void UpdateFpServer(FpServer* server, ReadyLevels* ready, taskid_t aLevel, simtime_t now) {
+	bool pending = ready->heads[aLevel] != NULL;
+
+	if (server->kind == SERVER_SPORADIC) {
+		while (server->refillHead < server->refillCount && server->refills[server->refillHead].time <= now) {
+			server->capacity += server->refills[server->refillHead].amount;
+			++server->refillHead;
+		}
+	}
+	else if (server->nextPeriod <= now) {
+		server->capacity = server->budget;
+		server->nextPeriod = ((uint64_t)now / server->period + 1) * server->period;
+	}
+
+	// The polling server only keeps its budget while it has jobs to spend it on
+	if (server->kind == SERVER_POLLING && !pending) {
+		server->capacity = 0;
+	}
+
+	// What the sporadic server uses while ready comes back a period after it became ready, right away if it stayed
+	// ready for longer than that (in which case it may carry on as if it had just become ready)
+	bool isReady = pending && server->capacity > 0;
+	if (server->kind == SERVER_SPORADIC && !isReady && server->active) {
+		if (server->activeSince + server->period <= now) {
+			server->capacity += server->consumed;
+			isReady = pending && server->capacity > 0;
+		}
+		else if (server->consumed > 0) {
+			if (server->refillCount == server->refillCapacity) {
+				server->refillCapacity = server->refillCapacity == 0 ? 16 : server->refillCapacity * 2;
+				server->refills = (FpRefill*)realloc(server->refills, sizeof(FpRefill) * server->refillCapacity);
+			}
+			server->refills[server->refillCount].time = server->activeSince + server->period;
+			server->refills[server->refillCount].amount = server->consumed;
+			++server->refillCount;
+		}
+		server->active = false;
+	}
+	if (server->kind == SERVER_SPORADIC && isReady && !server->active) {
+		server->active = true;
+		server->activeSince = now;
+		server->consumed = 0;
+	}
+
+	MarkLevel(ready, aLevel, isReady);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Generates a work-conserving preemptive fixed priority schedule, simulated forward in time (ASAP rather than ALAP)   |
+// Periodic tasks take the priorities RmSimulation places them in, aperiodic jobs share one level and run first come   |
+// first served: below every periodic task for rate monotonic (background service like ALAP RM), or ranked by their    |
+// APERIODIC_DEADLINE among the periodic tasks' implicit deadlines for deadline monotonic                              |
+// With a polling, deferrable or sporadic server in the plan, the level is instead the server's, ranked by its period  |
+// Ts like a periodic task and only ready while the server has budget left                                             |
+// Like EDF, a job which reaches its deadline unfinished is dropped                                                    |
+//---------------------------------------------------------------------------------------------------------------------+
+Schedule* FpSimulation(SimPlan* plan) {
+	Schedule* sched = MakeSchedule(plan);
+
+	// Same priority order as the ALAP simulation, and aperiodic jobs in release order
+	PeriodicTask** pTasks = (PeriodicTask**)calloc(sizeof(PeriodicTask*), plan->pCount + 1);
+	for (taskid_t task = 0; task < plan->pCount; task++) {
+		pTasks[task] = plan->pTasks + task;
+	}
+	sortTasks(pTasks, plan->pCount);
+	AperiodicTask** aTasks = (AperiodicTask**)calloc(sizeof(AperiodicTask*), plan->aCount + 1);
+	for (taskid_t task = 0; task < plan->aCount; task++) {
+		aTasks[task] = plan->aTasks + task;
+	}
+	sortTasks((PeriodicTask**)aTasks, plan->aCount);
+
+	// The aperiodic level sits below the periodic tasks whose deadlines are no later than its own (all of them for RM)
+	// A server's level sits below the periodic tasks whose periods are no longer than its own
+	FpServer server = MakeFpServer(plan);
+	taskid_t aLevel = plan->pCount;
+	if (server.kind != SERVER_NONE || plan->settings.asap == ASAP_DEADLINE_MONOTONIC) {
+		simtime_t aDeadline = server.kind != SERVER_NONE ? server.period : APERIODIC_DEADLINE;
+		aLevel = 0;
+		while (aLevel < plan->pCount && pTasks[aLevel]->T <= aDeadline) {
+			++aLevel;
+		}
+	}
+
+	size_t levels = (size_t)plan->pCount + 1;
+	size_t wordCount = (levels + 63) / 64;
+	ReadyLevels ready;
+	ready.heads = (FpJob**)calloc(sizeof(FpJob*), levels);
+	ready.tails = (FpJob**)calloc(sizeof(FpJob*), levels);
+	ready.words = (uint64_t*)calloc(sizeof(uint64_t), wordCount);
+	ready.summaryCount = (wordCount + 63) / 64;
+	ready.summary = (uint64_t*)calloc(sizeof(uint64_t), ready.summaryCount);
+
+	// One job per task, indexed by task index
+	FpJob* jobs = (FpJob*)calloc(sizeof(FpJob), (size_t)plan->tasks + 1);
+	for (taskid_t rank = 0; rank < plan->pCount; ++rank) {
+		FpJob* job = jobs + pTasks[rank]->taskIndex;
+		job->genericTask = pTasks[rank];
+		job->level = rank < aLevel ? rank : rank + 1;
+	}
+	for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+		FpJob* job = jobs + aTasks[aTask]->taskIndex;
+		job->genericTask = (PeriodicTask*)aTasks[aTask];
+		job->aperiodic = true;
+		job->level = aLevel;
+	}
+
+	// Every periodic task releases at 0 (already a heap, ranks ascending)
+	FpRelease* releases = (FpRelease*)malloc(sizeof(FpRelease) * ((size_t)plan->pCount + 1));
+	size_t releaseCount = plan->duration > 0 ? plan->pCount : 0;
+	for (taskid_t rank = 0; rank < releaseCount; ++rank) {
+		releases[rank].time = 0;
+		releases[rank].rank = rank;
+	}
+	taskid_t nextAperiodic = 0;
+
+	// Decisions are only made at releases, completions and aperiodic deadlines (a periodic deadline is the task's next
+	// release), so time jumps from one to the next
+	FpJob* last = NULL; // the job which ran in the tick before now, while it's still in flight
+	simtime_t now = 0;
+	while (now < sched->duration && !sched->stopped) {
+		// A periodic job still in flight at its task's next release has missed its deadline
+		while (releaseCount > 0 && releases[0].time == now) {
+			PeriodicTask* task = pTasks[releases[0].rank];
+			FpJob* job = jobs + task->taskIndex;
+			if (job->inFlight) {
+				MissFpJob(sched, &ready, job);
+				if (last == job) {
+					last = NULL;
+				}
+			}
+			job->inFlight = true;
+			job->runtime = task->C;
+			job->release = now;
+			job->deadline = (uint64_t)now + task->T;
+			PushLevel(&ready, job);
+			COUNT(jobsReleased, 1);
+
+			releases[0].time = job->deadline;
+			if (releases[0].time >= sched->duration) {
+				releases[0] = releases[--releaseCount];
+			}
+			if (releaseCount > 0) {
+				SiftFpRelease(releases, releaseCount, 0);
+			}
+		}
+		while (nextAperiodic < plan->aCount && aTasks[nextAperiodic]->r == now) {
+			FpJob* job = jobs + aTasks[nextAperiodic]->taskIndex;
+			job->inFlight = true;
+			job->runtime = aTasks[nextAperiodic]->C;
+			job->release = now;
+			job->deadline = (uint64_t)now + APERIODIC_DEADLINE;
+			PushLevel(&ready, job);
+			COUNT(jobsReleased, 1);
+			++nextAperiodic;
+		}
+
+		// Aperiodic jobs queue in release order, so the earliest aperiodic deadline is always at the head
+		while (ready.heads[aLevel] != NULL && ready.heads[aLevel]->deadline == now) {
+			if (last == ready.heads[aLevel]) {
+				last = NULL;
+			}
+			MissFpJob(sched, &ready, ready.heads[aLevel]);
+		}
+		if (server.kind != SERVER_NONE) {
+			UpdateFpServer(&server, &ready, aLevel, now);
+		}
+
+		// The highest ready level runs, preempting the job which ran last if it's a different one
+		size_t level = FirstLevel(&ready);
+		FpJob* job = level == NO_LEVEL ? NULL : ready.heads[level];
+		if (last != NULL && last != job) {
+			SetStatus(sched, now - 1, last->genericTask->taskIndex, STATUS_PREEMPTED);
+			COUNT(preemptions, 1);
+		}
+
+		// The next instant at which anything can change
+		uint64_t next = sched->duration;
+		if (releaseCount > 0 && releases[0].time < next) {
+			next = releases[0].time;
+		}
+		if (nextAperiodic < plan->aCount && aTasks[nextAperiodic]->r < next) {
+			next = aTasks[nextAperiodic]->r;
+		}
+		if (ready.heads[aLevel] != NULL && ready.heads[aLevel]->deadline < next) {
+			next = ready.heads[aLevel]->deadline;
+		}
+		if (server.kind == SERVER_SPORADIC && server.refillHead < server.refillCount &&
+			server.refills[server.refillHead].time < next) {
+			next = server.refills[server.refillHead].time;
+		}
+		else if (server.kind != SERVER_NONE && server.kind != SERVER_SPORADIC && server.nextPeriod < next) {
+			next = server.nextPeriod;
+		}
+
+		// A server runs aperiodic jobs until its budget runs out
+		if (job != NULL && job->aperiodic && server.kind != SERVER_NONE && (uint64_t)now + server.capacity < next) {
+			next = (uint64_t)now + server.capacity;
+		}
+
+		// Idle until then
+		if (job == NULL) {
+			last = NULL;
+			now = (simtime_t)next;
+			continue;
+		}
+
+		// Otherwise run the job up to then or its completion
+		uint64_t end = (uint64_t)now + job->runtime < next ? (uint64_t)now + job->runtime : next;
+		SetActive(sched, now, (simtime_t)end, job->genericTask->columnIndex);
+		job->runtime -= (simtime_t)(end - now);
+		if (job->aperiodic && server.kind != SERVER_NONE) {
+			server.capacity -= (simtime_t)(end - now);
+			server.consumed += (simtime_t)(end - now);
+			server.used += end - now;
+		}
+		last = job;
+		if (job->runtime == 0) {
+			if (job->aperiodic) {
+				sched->aperiodicResponseTimes += end - 1 - job->release;
+			}
+			PopLevel(&ready, job->level);
+			job->inFlight = false;
+			last = NULL;
+		}
+		now = (simtime_t)end;
+	}
+
+	// Jobs left in flight: those due right at the end have missed, aperiodic ones otherwise count up to the end
+	// (a simulation stopped at its first miss leaves them out, it only counts what it simulated)
+	for (taskid_t task = 0; task < plan->tasks && !sched->stopped; ++task) {
+		FpJob* job = jobs + task;
+		if (!job->inFlight) {
+			continue;
+		}
+		if (job->deadline == sched->duration) {
+			SetStatus(sched, sched->duration - 1, job->genericTask->taskIndex, STATUS_OVERDUE);
+			if (job->aperiodic) {
+				sched->aperiodicResponseTimes += sched->duration - 1 - job->release;
+			}
+		}
+		else if (job->aperiodic) {
+			sched->aperiodicResponseTimes += sched->duration - job->release;
+		}
+	}
+	COUNT(ticks, now);
+
+	sched->server = server.kind;
+	sched->serverBudget = ServerCapacity(&plan->server, plan->duration);
+	sched->serverUsed = server.used;
+	free(server.refills);
+
+	free(jobs);
+	free(releases);
+	free(ready.heads);
+	free(ready.tails);
+	free(ready.words);
+	free(ready.summary);
+	free(pTasks);
+	free(aTasks);
 
+	FinishSchedule(sched);
 	return sched;
 }
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Exact response-time analysis of the periodic tasks under the priorities RmSimulation uses, without simulating       |
+// R = C + sum(ceil(R / T_j) * C_j) over higher priority tasks j, iterated up from C + sum(C_j) until it settles       |
+//---------------------------------------------------------------------------------------------------------------------+
+Analysis* RmAnalysis(SimPlan* plan) {
+	Analysis* analysis = MakeAnalysis(plan);
+	analysis->fixedPriority = true;
+	analysis->schedulable = true;
+	analysis->busyPeriod = PlanBusyPeriod(plan);
+
+	// Same priority order as the simulation
+	PeriodicTask** pTasks = (PeriodicTask**)calloc(sizeof(PeriodicTask*), plan->pCount);
+	for (taskid_t task = 0; task < plan->pCount; task++) {
+		pTasks[task] = plan->pTasks + task;
+	}
+	sortTasks(pTasks, plan->pCount);
+
+	uint64_t higher = 0; // sum of C over every higher priority task
+	for (taskid_t rank = 0; rank < plan->pCount; ++rank) {
+		PeriodicTask* task = pTasks[rank];
+		taskid_t pTask = (taskid_t)(task - plan->pTasks);
+		analysis->order[rank] = pTask;
+
+		// The critical instant is the synchronous release at 0, so the first job's response is the worst one
+		// Every iterate is a lower bound on that response, so stopping once past the deadline is still exact
+		uint64_t response = task->C + higher, next = 0;
+		while (response <= task->T && response != next) {
+			next = response;
+			response = task->C;
+			for (taskid_t hp = 0; hp < rank; ++hp) {
+				response += (next + pTasks[hp]->T - 1) / pTasks[hp]->T * pTasks[hp]->C;
+			}
+		}
+
+		analysis->response[pTask] = response;
+		analysis->meetsDeadline[pTask] = response <= task->T;
+		if (!analysis->meetsDeadline[pTask]) {
+			analysis->schedulable = false;
+
+			// That first job is the earliest to miss for this task
+			if (task->T < plan->duration && (analysis->firstMiss == 0 || task->T < analysis->firstMiss)) {
+				analysis->firstMiss = task->T;
+			}
+		}
+
+		higher += task->C;
+	}
+
+	free(pTasks);
+	return analysis;
+}
@@ -0,0 +1,107 @@
+#include "parser.h"
+#include "reporter.h"
+#include <string.h>
+#include <time.h>
+
+#ifdef SIM_STATS
+// One set per thread so batch workers can count side by side
+_Thread_local SimCounters simCounters;
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - seconds on the given clock                                                                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline double ClockSeconds(clockid_t clock) {
+	struct timespec now;
+	clock_gettime(clock, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Starts (or resumes) timing a phase, CPU time is the whole process's so render threads are included                  |
+//---------------------------------------------------------------------------------------------------------------------+
+void StartPhase(PhaseTimer* timer) {
+	timer->wall -= ClockSeconds(CLOCK_MONOTONIC);
+	timer->cpu -= ClockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Stops timing a phase, adding the time since the matching StartPhase                                                 |
+//---------------------------------------------------------------------------------------------------------------------+
+void StopPhase(PhaseTimer* timer) {
+	timer->wall += ClockSeconds(CLOCK_MONOTONIC);
+	timer->cpu += ClockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Zeroes the calling thread's counters ahead of a simulation (nothing to do without SIM_STATS)                        |
+//---------------------------------------------------------------------------------------------------------------------+
+void ResetCounters(void) {
+#ifdef SIM_STATS
+	memset(&simCounters, 0, sizeof(SimCounters));
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Returns what the calling thread has counted since ResetCounters (all zero without SIM_STATS)                        |
+//---------------------------------------------------------------------------------------------------------------------+
+SimCounters TakeCounters(void) {
+#ifdef SIM_STATS
+	return simCounters;
+#else
+	SimCounters counters;
+	memset(&counters, 0, sizeof(SimCounters));
+	return counters;
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - writes a phase timer as a JSON object                                                                      |
+//---------------------------------------------------------------------------------------------------------------------+
+static void WritePhase(FILE* fout, const char* name, PhaseTimer* timer) {
+	fprintf(fout, "\"%s\":{\"wall\":%.6f,\"cpu\":%.6f}", name, timer->wall, timer->cpu);
+}
+
+#ifdef SIM_STATS
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - writes an engine's counters as a JSON object                                                               |
+//---------------------------------------------------------------------------------------------------------------------+
+static void WriteCounters(FILE* fout, const char* name, SimCounters* counters) {
+	fprintf(fout, "\"%s\":{\"ticks\":%llu,\"jobsReleased\":%llu,\"queueOps\":%llu,\"preemptions\":%llu,\"scanSteps\":%llu}",
+		name, (unsigned long long)counters->ticks, (unsigned long long)counters->jobsReleased,
+		(unsigned long long)counters->queueOps, (unsigned long long)counters->preemptions,
+		(unsigned long long)counters->scanSteps);
+}
+#endif
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes the phase timers and engine counters of a run as one line of JSON (seconds for the timers)                   |
+// The counters are null when they were compiled out                                                                   |
+//---------------------------------------------------------------------------------------------------------------------+
+void WriteStats(FILE* fout, SimStats* stats) {
+	fprintf(fout, "{\"type\":\"stats\",\"phases\":{");
+	WritePhase(fout, "parse", &stats->parse);
+	fprintf(fout, ",");
+	WritePhase(fout, "rm", &stats->rmSimulation);
+	fprintf(fout, ",");
+	WritePhase(fout, "edf", &stats->edfSimulation);
+	fprintf(fout, ",");
+	WritePhase(fout, "asap", &stats->asapSimulation);
+	fprintf(fout, ",");
+	WritePhase(fout, "report", &stats->report);
+	fprintf(fout, ",");
+	WritePhase(fout, "analysis", &stats->analysis);
+	fprintf(fout, "},\"counters\":");
+
+#ifdef SIM_STATS
+	fprintf(fout, "{");
+	WriteCounters(fout, "rm", &stats->rm);
+	fprintf(fout, ",");
+	WriteCounters(fout, "edf", &stats->edf);
+	fprintf(fout, ",");
+	WriteCounters(fout, "asap", &stats->asap);
+	fprintf(fout, "}}\n");
+#else
+	fprintf(fout, "null}\n");
+#endif
+}
@@ -0,0 +1,317 @@
+#include "parser.h"
+#include "reporter.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Machine-readable alternatives to the table written by WriteSchedule, emitted from the same Schedule                  |
+//                                                                                                                     |
+// Binary trace, one section per schedule, every integer an unsigned LEB128 varint:                                    |
+//   "L2TR" version(=1) name-length name duration pCount aCount                                                        |
+//   then per task (column order): id-length id C T-or-r                                                               |
+//   then records in time order, each a tag byte followed by its fields (times are deltas from the previous record)    |
+// Records only ever look back at the previous record's time, so a reader can process the trace as it streams in       |
+//                                                                                                                     |
+// CSV and JSON lines: one interval or event per line with full task IDs, times in ticks                               |
+//---------------------------------------------------------------------------------------------------------------------+
+
+// Record tags of the binary trace
+enum
+{
+	TRACE_END           = 0, // busy ticks, missed deadlines, preemptions, summed aperiodic response, aCount
+	TRACE_RUN           = 1, // start delta, length, task column (1 => first task)
+	TRACE_EVENT         = 2, // time delta, task index (0 => first task), status character
+};
+
+// Walks the runs and events of either layout in time order
+typedef struct {
+	Schedule* sched;
+	size_t run; // next run (compact) or next tick to scan for one (dense)
+	size_t event; // next event (compact) or next flag to scan (dense)
+} TraceCursor;
+
+// State shared by the emitters of one section
+typedef struct {
+	FILE* fout;
+	uint8_t format;
+	const char* scheduler;
+	Schedule* sched;
+	uint64_t last; // time of the previous binary record
+} TraceWriter;
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - writes an unsigned LEB128 varint: 7 bits per byte, low bits first, high bit set on all but the last        |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void PutVarint(FILE* fout, uint64_t n) {
+	while (n >= 0x80) {
+		putc((int)(n & 0x7F) | 0x80, fout);
+		n >>= 7;
+	}
+	putc((int)n, fout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - writes a varint length followed by the string's bytes                                                      |
+//---------------------------------------------------------------------------------------------------------------------+
+static inline void PutString(FILE* fout, const char* text) {
+	size_t len = strlen(text);
+	PutVarint(fout, len);
+	fwrite(text, 1, len, fout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - long name of a status flag for the text formats                                                            |
+//---------------------------------------------------------------------------------------------------------------------+
+static const char* StatusName(char status) {
+	switch (status) {
+		case STATUS_RELEASED:
+			return "released";
+		case STATUS_PREEMPTED:
+			return "preempted";
+		case STATUS_OVERDUE:
+			return "overdue";
+	}
+	return "unknown";
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - finds the next run of a task (slack is skipped), returns false once there are none left                    |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool NextRun(TraceCursor* cursor, ScheduleRun* out) {
+	Schedule* sched = cursor->sched;
+
+	if (sched->activeTask == NULL) {
+		while (cursor->run < sched->runCount) {
+			*out = sched->runs[cursor->run++];
+			if (out->task != 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Dense layout: skip the slack, then extend over the same task
+	size_t time = cursor->run;
+	while (time < sched->duration && sched->activeTask[time] == 0) {
+		++time;
+	}
+	if (time >= sched->duration) {
+		cursor->run = time;
+		return false;
+	}
+
+	out->start = (simtime_t)time;
+	out->task = sched->activeTask[time];
+	while (time < sched->duration && sched->activeTask[time] == out->task) {
+		++time;
+	}
+	out->end = (simtime_t)time;
+	cursor->run = time;
+	return true;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - the first tick from the given one on at which some task has a status in the dense layout                   |
+// Returns the duration or later when there is none                                                                    |
+//---------------------------------------------------------------------------------------------------------------------+
+static uint64_t NextStatusTick(Schedule* sched, uint64_t from) {
+	size_t plane_n = (size_t)STATUS_PLANES * sched->tasks;
+	uint64_t mask = ~0ull << (from & 63);
+	for (size_t word = from >> 6; word < sched->planeWords; ++word, mask = ~0ull) {
+		uint64_t any = 0;
+		for (size_t plane = 0; plane < plane_n; ++plane) {
+			any |= sched->planes[(plane * sched->planeWords) + word];
+		}
+		if ((any & mask) != 0) {
+			return ((uint64_t)word << 6) + (uint64_t)__builtin_ctzll(any & mask);
+		}
+	}
+	return sched->duration;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - finds the next status event, returns false once there are none left                                        |
+//---------------------------------------------------------------------------------------------------------------------+
+static bool NextEvent(TraceCursor* cursor, ScheduleEvent* out) {
+	Schedule* sched = cursor->sched;
+
+	if (sched->planes == NULL) {
+		if (cursor->event < sched->eventCount) {
+			*out = sched->events[cursor->event++];
+			return true;
+		}
+		return false;
+	}
+
+	// Dense layout: scan the cells in (time, task) order for anything that isn't blank, jumping over the ticks at which
+	// no task has a status
+	size_t cell_n = (size_t)sched->duration * sched->tasks;
+	while (cursor->event < cell_n) {
+		uint64_t time = cursor->event / sched->tasks;
+		taskid_t task = (taskid_t)(cursor->event % sched->tasks);
+		if (task == 0) {
+			time = NextStatusTick(sched, time);
+			if (time >= sched->duration) {
+				cursor->event = cell_n;
+				return false;
+			}
+		}
+
+		for (; task < sched->tasks; ++task) {
+			char status = GetStatus(sched, (simtime_t)time, task);
+			if (status != STATUS_NONE) {
+				cursor->event = ((size_t)time * sched->tasks) + task + 1;
+				out->time = (simtime_t)time;
+				out->taskIndex = task;
+				out->status = status;
+				return true;
+			}
+		}
+		cursor->event = ((size_t)time + 1) * sched->tasks;
+	}
+	return false;
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - emits one run in the writer's format                                                                       |
+//---------------------------------------------------------------------------------------------------------------------+
+static void EmitRun(TraceWriter* writer, ScheduleRun* run) {
+	const char* id = writer->sched->header[run->task - 1];
+
+	switch (writer->format) {
+		case FORMAT_BINARY:
+			putc(TRACE_RUN, writer->fout);
+			PutVarint(writer->fout, run->start - writer->last);
+			PutVarint(writer->fout, run->end - run->start);
+			PutVarint(writer->fout, run->task);
+			writer->last = run->start;
+			break;
+		case FORMAT_CSV:
+			fprintf(writer->fout, "%s,run,%llu,%llu,%s,\r\n",
+				writer->scheduler, (unsigned long long)run->start, (unsigned long long)run->end, id);
+			break;
+		case FORMAT_JSONL:
+			fprintf(writer->fout, "{\"scheduler\":\"%s\",\"type\":\"run\",\"start\":%llu,\"end\":%llu,\"task\":\"%s\"}\n",
+				writer->scheduler, (unsigned long long)run->start, (unsigned long long)run->end, id);
+			break;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Helper - emits one status event in the writer's format                                                              |
+//---------------------------------------------------------------------------------------------------------------------+
+static void EmitEvent(TraceWriter* writer, ScheduleEvent* event) {
+	const char* id = writer->sched->header[event->taskIndex];
+
+	switch (writer->format) {
+		case FORMAT_BINARY:
+			putc(TRACE_EVENT, writer->fout);
+			PutVarint(writer->fout, event->time - writer->last);
+			PutVarint(writer->fout, event->taskIndex);
+			putc(event->status, writer->fout);
+			writer->last = event->time;
+			break;
+		case FORMAT_CSV:
+			fprintf(writer->fout, "%s,event,%llu,,%s,%s\r\n",
+				writer->scheduler, (unsigned long long)event->time, id, StatusName(event->status));
+			break;
+		case FORMAT_JSONL:
+			fprintf(writer->fout, "{\"scheduler\":\"%s\",\"type\":\"event\",\"time\":%llu,\"task\":\"%s\",\"status\":\"%s\"}\n",
+				writer->scheduler, (unsigned long long)event->time, id, StatusName(event->status));
+			break;
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes what has to come once at the top of a trace file (the CSV column names), nothing for the other formats       |
+//---------------------------------------------------------------------------------------------------------------------+
+void WriteTraceHeader(FILE* fout, uint8_t format) {
+	if (format == FORMAT_CSV) {
+		fprintf(fout, "scheduler,kind,start,end,task,status\r\n");
+	}
+}
+
+//---------------------------------------------------------------------------------------------------------------------+
+// Writes the given schedule as a section of a binary, CSV or JSON lines trace under the given scheduler name          |
+// Returns the same summary statistics WriteSchedule would have printed                                                |
+//---------------------------------------------------------------------------------------------------------------------+
+ScheduleSummary WriteTrace(FILE* fout, SimPlan* plan, Schedule* sched, const char* scheduler, uint8_t format) {
+	TraceWriter writer = { fout, format, scheduler, sched, 0 };
+
+	if (format == FORMAT_BINARY) {
+		fwrite("L2TR", 1, 4, fout);
+		putc(1, fout);
+		PutString(fout, scheduler);
+		PutVarint(fout, sched->duration);
+		PutVarint(fout, plan->pCount);
+		PutVarint(fout, plan->aCount);
+		for (taskid_t pTask = 0; pTask < plan->pCount; ++pTask) {
+			PutString(fout, plan->pTasks[pTask].ID);
+			PutVarint(fout, plan->pTasks[pTask].C);
+			PutVarint(fout, plan->pTasks[pTask].T);
+		}
+		for (taskid_t aTask = 0; aTask < plan->aCount; ++aTask) {
+			PutString(fout, plan->aTasks[aTask].ID);
+			PutVarint(fout, plan->aTasks[aTask].C);
+			PutVarint(fout, plan->aTasks[aTask].r);
+		}
+	}
+
+	// Merge the runs and events by time, a run goes before the events of the tick it starts on
+	uint64_t busy = 0, dTotal = 0, pTotal = 0;
+	TraceCursor runs = { sched, 0, 0 };
+	TraceCursor events = { sched, 0, 0 };
+	ScheduleRun run;
+	ScheduleEvent event;
+	bool haveRun = NextRun(&runs, &run);
+	bool haveEvent = NextEvent(&events, &event);
+	while (haveRun || haveEvent) {
+		if (haveRun && (!haveEvent || run.start <= event.time)) {
+			if (run.task <= sched->tasks) {
+				busy += run.end - run.start;
+				EmitRun(&writer, &run);
+			}
+			haveRun = NextRun(&runs, &run);
+		}
+		else {
+			dTotal += event.status == STATUS_OVERDUE;
+			pTotal += event.status == STATUS_PREEMPTED;
+			EmitEvent(&writer, &event);
+			haveEvent = NextEvent(&events, &event);
+		}
+	}
+
+	ScheduleSummary summary;
+	summary.utilization = ((float)busy) / sched->duration;
+	summary.missedDeadlines = dTotal;
+	summary.preemptions = pTotal;
+	summary.aperiodicResponse = sched->aperiodicResponseTimes / (float)sched->aCount;
+
+	switch (format) {
+		case FORMAT_BINARY:
+			putc(TRACE_END, fout);
+			PutVarint(fout, busy);
+			PutVarint(fout, dTotal);
+			PutVarint(fout, pTotal);
+			PutVarint(fout, sched->aperiodicResponseTimes);
+			PutVarint(fout, sched->aCount);
+			break;
+		case FORMAT_JSONL:
+			fprintf(fout,
+				"{\"scheduler\":\"%s\",\"type\":\"summary\",\"utilization\":%.4f,\"missedDeadlines\":%llu,"
+				"\"preemptions\":%llu,\"aperiodicResponse\":",
+				scheduler, summary.utilization, (unsigned long long)dTotal, (unsigned long long)pTotal);
+
+			// JSON has no NaN, so a plan without aperiodic tasks gets null
+			if (sched->aCount > 0) {
+				fprintf(fout, "%.2f}\n", summary.aperiodicResponse);
+			}
+			else {
+				fprintf(fout, "null}\n");
+			}
+			break;
+	}
+
+	return summary;
+}